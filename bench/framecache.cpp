@@ -0,0 +1,100 @@
+// Writes the frame cache of every sequence of the config with ground truth:
+// its frames decoded from the configured input, deinterlaced if configured and scaled for
+// the first ground truth box, to <seqName>_cache.bin in the sequence directory.
+// The config can then track them with input = cache.
+//
+// usage: PAWSS_cache [config]
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "Config.h"
+#include "FrameCache.h"
+#include "FramePrefetcher.h"
+#include "FrameSource.h"
+#include "FrameTracker.h"
+#include "Rect.h"
+#include "mUtils.h"
+
+// write the cache of sequence seqIdx of conf
+static bool writeCache(Config& conf, int seqIdx)
+{
+    conf.mSeqName = conf.mSeqNames[seqIdx];
+    std::string seqPath = conf.mSeqBasePath + "/" + conf.mSeqName + "/" + conf.mSeqName;
+    std::vector<FloatRect> gtBBs;
+    if(!readGtFile(seqPath + "_gt.txt", gtBBs) || gtBBs.empty())
+    {
+        std::cout << "skipping " << conf.mSeqName << ": no ground truth to scale the frames for" << std::endl;
+        return false;
+    }
+    int startFrame, endFrame;
+    if(!readFramesFile(seqPath + "_frames.txt", startFrame, endFrame))
+    {
+        if(conf.mInputType == Config::kInputTypeImages)
+            return false;
+        startFrame = 1;
+        endFrame = INT_MAX;
+    }
+    std::unique_ptr<FrameSource> source(FrameSource::Create(conf, startFrame));
+    if(!source)
+        return false;
+
+    float scaleW, scaleH;
+    FrameTracker::GetFrameScale(conf, gtBBs[0], scaleW, scaleH);
+    std::string cachePath = FrameCacheSource::GetPath(conf);
+    FrameCacheWriter writer(cachePath, startFrame, scaleW, scaleH);
+    if(!writer.IsOpened())
+    {
+        std::cout << "error: could not open frame cache file: " << cachePath << std::endl;
+        return false;
+    }
+
+    FramePrefetcher prefetcher(*source, startFrame, endFrame, scaleW, scaleH, conf.mDeinterlace,
+                               FrameTracker::GetFrameInterpolation(conf, scaleW, scaleH), std::max(1, conf.mDecodeThreads));
+    cv::Mat frameOrig, frame;
+    int frameInd = startFrame;
+    for(; prefetcher.Next(frameOrig, frame); ++frameInd)
+    {
+        if(frameOrig.empty())
+        {
+            // end of a video or stream
+            if(!source->IsRandomAccess())
+                break;
+            std::cout << "error: could not read frame: " << frameInd << std::endl;
+            return false;
+        }
+        if(!writer.Write(frame))
+            return false;
+    }
+    if(!writer.Close())
+    {
+        std::cout << "error: could not write frame cache file: " << cachePath << std::endl;
+        return false;
+    }
+    std::cout << conf.mSeqName << ": " << frameInd - startFrame << " frames scaled by "
+              << scaleW << "x" << scaleH << " to " << cachePath << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    Config conf(argc > 1 ? argv[1] : "./config.txt");
+    if(!conf.check())
+        return EXIT_FAILURE;
+    conf.mUseCamera = false;
+    if(conf.mInputType == Config::kInputTypeCache)
+    {
+        std::cout << "error: the frame cache is written from another input" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    for(int i=0; i<(int)conf.mSeqNames.size(); ++i)
+        ok = writeCache(conf, i) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,332 @@
+// End-to-end regression harness: tracks every sequence of the config with
+// ground truth in quiet mode and writes throughput, per-frame latency,
+// precision and peak memory as JSON. Given a baseline written by an earlier
+// run, fails if the throughput or the precision at 20 pixels regressed by more
+// than the tolerances.
+//
+// usage: PAWSS_harness [config] [--out results.json] [--baseline baseline.json]
+//                      [--fps-tolerance 0.1] [--precision-tolerance 0.02]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <opencv2/opencv.hpp>
+#include "Config.h"
+#include "FramePrefetcher.h"
+#include "FrameSource.h"
+#include "FrameTracker.h"
+#include "Rect.h"
+#include "mUtils.h"
+
+static const int kPrecisionThreshold = 20;
+
+struct SequenceResult
+{
+    std::string mName;
+    int mFrames;
+    double mSeconds;
+    std::vector<double> mLatencies;  // ms per frame, reading to tracked
+    std::vector<float> mPrecision;
+};
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if(sorted.empty())
+        return 0.0;
+    return sorted[std::min(sorted.size()-1, (size_t)(p * sorted.size()))];
+}
+
+static long peakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on OS X
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// track sequence seqIdx of conf without any output, false if it could not be
+// tracked; hasGt is false for sequences without ground truth, which are skipped
+static bool runSequence(Config& conf, int seqIdx, SequenceResult& result, bool& hasGt)
+{
+    conf.mSeqName = conf.mSeqNames[seqIdx];
+    result.mName = conf.mSeqName;
+    std::string seqPath = conf.mSeqBasePath + "/" + conf.mSeqName + "/" + conf.mSeqName;
+    int startFrame, endFrame;
+    std::vector<FloatRect> gtBBs, rBBs;
+    hasGt = readGtFile(seqPath + "_gt.txt", gtBBs) && !gtBBs.empty();
+    if(!hasGt)
+    {
+        std::cout << "skipping " << conf.mSeqName << ": no ground truth" << std::endl;
+        return false;
+    }
+    if(!readFramesFile(seqPath + "_frames.txt", startFrame, endFrame))
+    {
+        startFrame = 1;
+        endFrame = startFrame + gtBBs.size() - 1;
+    }
+    std::unique_ptr<FrameSource> source(FrameSource::Create(conf, startFrame));
+    if(!source)
+    {
+        std::cout << "error: could not open the frames of " << conf.mSeqName << std::endl;
+        return false;
+    }
+
+    // the frames of a frame cache are already scaled, for the first ground truth box
+    const bool prepared = source->IsPrepared();
+    if(prepared)
+    {
+        float scaleW, scaleH;
+        FrameTracker::GetFrameScale(conf, gtBBs[0], scaleW, scaleH);
+        if(std::fabs(scaleW - source->GetScaleW()) > 1e-6 || std::fabs(scaleH - source->GetScaleH()) > 1e-6)
+        {
+            std::cout << "error: the frame cache of " << conf.mSeqName << " is scaled differently, write it again" << std::endl;
+            return false;
+        }
+    }
+
+    FrameTracker tracker(conf);
+    std::unique_ptr<FramePrefetcher> prefetcher;
+
+    std::chrono::steady_clock::time_point seqStart = std::chrono::steady_clock::now();
+    for(int frameInd = startFrame; frameInd <= endFrame; ++frameInd)
+    {
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        cv::Mat frameOrig, frame;
+        if(frameInd > startFrame && prefetcher)
+            prefetcher->Next(frameOrig, frame);
+        else
+            source->Read(frameInd, frameOrig);
+        if(frameOrig.empty())
+        {
+            if(!source->IsRandomAccess())
+                break;
+            std::cout << "error: could not read frame " << frameInd << " of " << conf.mSeqName << std::endl;
+            return false;
+        }
+
+        if(prepared)
+            frame = frameOrig;
+
+        if(frameInd == startFrame)
+        {
+            if(prepared)
+                tracker.InitialisePrepared(frame, gtBBs[0]);
+            else
+                tracker.Initialise(frameOrig, gtBBs[0]);
+            // the frames after the first are read and scaled ahead on decode threads
+            if(!prepared && conf.mDecodeThreads > 0)
+                prefetcher.reset(new FramePrefetcher(*source, startFrame+1, endFrame, tracker.GetScaleW(), tracker.GetScaleH(),
+                                                     conf.mDeinterlace, tracker.GetInterpolation(), conf.mDecodeThreads));
+        }
+        else if(frame.empty())
+            tracker.Track(frameOrig);
+        else
+            tracker.TrackPrepared(frame);
+        rBBs.push_back(tracker.GetBB());
+        result.mLatencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+    }
+    tracker.Reset();
+    result.mSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - seqStart).count();
+    result.mFrames = rBBs.size();
+
+    // a video may end before its ground truth
+    gtBBs.resize(std::min(gtBBs.size(), rBBs.size()));
+    rBBs.resize(gtBBs.size());
+    result.mPrecision = estPrecision(rBBs, gtBBs);
+    return !result.mPrecision.empty();
+}
+
+static void writeLatencies(std::ostream& out, std::vector<double> latencies, const std::string& indent)
+{
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0.0;
+    for(int i=0; i<(int)latencies.size(); ++i)
+        sum += latencies[i];
+    out << indent << "\"latency_ms\": {\"mean\": " << (latencies.empty() ? 0.0 : sum / latencies.size())
+        << ", \"p50\": " << percentile(latencies, 0.5) << ", \"p95\": " << percentile(latencies, 0.95)
+        << ", \"p99\": " << percentile(latencies, 0.99) << ", \"max\": " << (latencies.empty() ? 0.0 : latencies.back()) << "}";
+}
+
+static void writePrecision(std::ostream& out, const std::vector<float>& prec, const std::string& indent)
+{
+    out << indent << "\"precision_at_" << kPrecisionThreshold << "\": "
+        << ((int)prec.size() > kPrecisionThreshold ? prec[kPrecisionThreshold] : 0.f) << "," << std::endl;
+    out << indent << "\"precision\": [";
+    for(int i=0; i<(int)prec.size(); ++i)
+        out << (i ? ", " : "") << prec[i];
+    out << "]";
+}
+
+// the summary keys come first, so that readJsonNumber finds them before the per sequence ones
+static void writeJson(std::ostream& out, const std::vector<SequenceResult>& results, long rssKb,
+                      double& fps, float& prec20)
+{
+    int frames = 0;
+    double seconds = 0.0;
+    std::vector<double> latencies;
+    std::vector<float> meanPrec;
+    for(int i=0; i<(int)results.size(); ++i)
+    {
+        frames += results[i].mFrames;
+        seconds += results[i].mSeconds;
+        latencies.insert(latencies.end(), results[i].mLatencies.begin(), results[i].mLatencies.end());
+        meanPrec.resize(results[i].mPrecision.size(), 0.f);
+        for(int j=0; j<(int)meanPrec.size(); ++j)
+            meanPrec[j] += results[i].mPrecision[j] / results.size();
+    }
+    fps = seconds > 0.0 ? frames / seconds : 0.0;
+    prec20 = (int)meanPrec.size() > kPrecisionThreshold ? meanPrec[kPrecisionThreshold] : 0.f;
+
+    out << std::fixed << std::setprecision(4);
+    out << "{" << std::endl;
+    out << "  \"fps\": " << fps << "," << std::endl;
+    out << "  \"frames\": " << frames << "," << std::endl;
+    out << "  \"peak_rss_kb\": " << rssKb << "," << std::endl;
+    writeLatencies(out, latencies, "  ");
+    out << "," << std::endl;
+    writePrecision(out, meanPrec, "  ");
+    out << "," << std::endl;
+    out << "  \"sequences\": [" << std::endl;
+    for(int i=0; i<(int)results.size(); ++i)
+    {
+        const SequenceResult& r = results[i];
+        out << "    {" << std::endl;
+        out << "      \"name\": \"" << r.mName << "\"," << std::endl;
+        out << "      \"fps\": " << (r.mSeconds > 0.0 ? r.mFrames / r.mSeconds : 0.0) << "," << std::endl;
+        out << "      \"frames\": " << r.mFrames << "," << std::endl;
+        writeLatencies(out, r.mLatencies, "      ");
+        out << "," << std::endl;
+        writePrecision(out, r.mPrecision, "      ");
+        out << std::endl << "    }" << (i+1 < (int)results.size() ? "," : "") << std::endl;
+    }
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
+
+// value of the first "key": number in text
+static bool readJsonNumber(const std::string& text, const std::string& key, double& value)
+{
+    size_t pos = text.find("\"" + key + "\"");
+    if(pos == std::string::npos)
+        return false;
+    pos = text.find(':', pos);
+    if(pos == std::string::npos)
+        return false;
+    std::istringstream iss(text.substr(pos+1));
+    return (bool)(iss >> value);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string configPath = "./config.txt";
+    std::string outPath, baselinePath;
+    double fpsTolerance = 0.1;
+    double precTolerance = 0.02;
+    for(int i=1; i<argc; ++i)
+    {
+        std::string arg = argv[i];
+        if(arg == "--out" && i+1 < argc)
+            outPath = argv[++i];
+        else if(arg == "--baseline" && i+1 < argc)
+            baselinePath = argv[++i];
+        else if(arg == "--fps-tolerance" && i+1 < argc)
+            fpsTolerance = atof(argv[++i]);
+        else if(arg == "--precision-tolerance" && i+1 < argc)
+            precTolerance = atof(argv[++i]);
+        else
+            configPath = arg;
+    }
+
+    Config conf(configPath);
+    if(!conf.check())
+        return EXIT_FAILURE;
+    conf.mQuietMode = true;
+    conf.mDebugMode = false;
+    conf.mUseCamera = false;
+
+    // results over fewer sequences are not comparable to the baseline, so any
+    // sequence with ground truth which cannot be tracked fails the run
+    std::vector<SequenceResult> results;
+    bool failed = false;
+    for(int i=0; i<(int)conf.mSeqNames.size(); ++i)
+    {
+        SequenceResult result;
+        bool hasGt;
+        if(runSequence(conf, i, result, hasGt))
+        {
+            results.push_back(result);
+            std::cout << result.mName << ": " << result.mFrames << " frames, "
+                      << result.mFrames / result.mSeconds << " fps" << std::endl;
+        }
+        else if(hasGt)
+            failed = true;
+    }
+    if(failed)
+    {
+        std::cout << "error: not every sequence with ground truth could be tracked" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(results.empty())
+    {
+        std::cout << "error: no sequence with ground truth could be tracked" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    double fps;
+    float prec20;
+    std::ostringstream json;
+    writeJson(json, results, peakRssKb(), fps, prec20);
+    if(outPath.empty())
+        std::cout << json.str();
+    else
+    {
+        std::ofstream outFile(outPath.c_str());
+        if(!outFile.is_open())
+        {
+            std::cout << "error: could not open output file: " << outPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        outFile << json.str();
+    }
+
+    if(baselinePath.empty())
+        return EXIT_SUCCESS;
+
+    std::ifstream baselineFile(baselinePath.c_str());
+    std::stringstream baseline;
+    baseline << baselineFile.rdbuf();
+    double baseFps, basePrec20;
+    if(!readJsonNumber(baseline.str(), "fps", baseFps) ||
+       !readJsonNumber(baseline.str(), "precision_at_" + std::to_string(kPrecisionThreshold), basePrec20))
+    {
+        std::cout << "error: could not read baseline file: " << baselinePath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bool regressed = false;
+    std::cout << "fps " << fps << " (baseline " << baseFps << "), precision at "
+              << kPrecisionThreshold << " pixels " << prec20 << " (baseline " << basePrec20 << ")" << std::endl;
+    if(fps < baseFps * (1.0 - fpsTolerance))
+    {
+        std::cout << "regression: fps dropped by more than " << fpsTolerance*100 << "%" << std::endl;
+        regressed = true;
+    }
+    if(prec20 < basePrec20 - precTolerance)
+    {
+        std::cout << "regression: precision dropped by more than " << precTolerance << std::endl;
+        regressed = true;
+    }
+    return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,418 @@
+// Microbenchmarks of the hot parts of the tracker on synthetic, deterministic
+// inputs: patch features, kernels, SVM updates, the bin and gradient images and
+// the scale estimator. Prints the median time of each case in milliseconds.
+// First checks that the fast search paths agree with the per sample scores and
+// the exhaustive search, and fails if they do not.
+//
+// usage: PAWSS_bench [repeats]
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "Config.h"
+#include "ImageRep.h"
+#include "Kernels.h"
+#include "Rng.h"
+#include "Sample.h"
+#include "Tracker.h"
+#include "mUtils.h"
+#include "scaleEstimator.h"
+#include "structuredSVM.h"
+#include "Features/GradFeature.h"
+#include "Features/HsvFeature.h"
+#include "Features/PatchGradFeature.h"
+#include "Features/PatchGrayFeature.h"
+#include "Features/PatchGrayGFeature.h"
+#include "Features/PatchHsvFeature.h"
+#include "Features/PatchHsvGFeature.h"
+#include "Features/PatchRgbFeature.h"
+#include "Features/PatchRgbGFeature.h"
+
+static const int kImageWidth = 640;
+static const int kImageHeight = 480;
+static const int kSearchRadius = 30;
+
+static int gRepeats = 20;
+
+// median duration in ms of gRepeats calls of f, after one warm-up call
+template<typename F>
+static double timeMedian(F f)
+{
+    std::vector<double> times;
+    f();
+    for(int i=0; i<gRepeats; ++i)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        f();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::nth_element(times.begin(), times.begin() + times.size()/2, times.end());
+    return times[times.size()/2];
+}
+
+static void report(const std::string& name, const std::string& param, double ms)
+{
+    printf("%-28s %-16s %10.4f ms\n", name.c_str(), param.c_str(), ms);
+}
+
+// smooth texture with noise, shifted by dx and scaled by scale around the centre
+static cv::Mat syntheticImage(float dx, float scale, Rng& rng)
+{
+    cv::Mat img(kImageHeight, kImageWidth, CV_8UC3);
+    const float cx = kImageWidth / 2.f;
+    const float cy = kImageHeight / 2.f;
+    for(int y=0; y<img.rows; ++y)
+    {
+        for(int x=0; x<img.cols; ++x)
+        {
+            float u = (x - cx) / scale + cx - dx;
+            float v = (y - cy) / scale + cy;
+            float t = 0.5f + 0.25f*std::sin(u*0.07f) + 0.25f*std::cos(v*0.05f + u*0.01f);
+            cv::Vec3b& p = img.at<cv::Vec3b>(y, x);
+            p[0] = cv::saturate_cast<uchar>(255*t + rng.NextFloat(-8.f, 8.f));
+            p[1] = cv::saturate_cast<uchar>(255*(1-t) + rng.NextFloat(-8.f, 8.f));
+            p[2] = cv::saturate_cast<uchar>(128*t + 64 + rng.NextFloat(-8.f, 8.f));
+        }
+    }
+    return img;
+}
+
+static FloatRect centredBox(int size)
+{
+    return FloatRect(kImageWidth/2 - size/2, kImageHeight/2 - size/2, size, size);
+}
+
+static void insideSamples(const ImageRep& image, const std::vector<FloatRect>& rects, std::vector<FloatRect>& kept)
+{
+    kept.clear();
+    for(int i=0; i<(int)rects.size(); ++i)
+    {
+        if(rects[i].IsInside(image.GetRect()))
+            kept.push_back(rects[i]);
+    }
+}
+
+static PatchFeature* newFeature(Config::FeatureType type, const Config& conf)
+{
+    switch(type) {
+    case Config::kFeatureTypePatchGrad:
+        return new PatchGradFeature(conf);
+    case Config::kFeatureTypePatchGray:
+        return new PatchGrayFeature(conf);
+    case Config::kFeatureTypePatchGrayG:
+        return new PatchGrayGFeature(conf);
+    case Config::kFeatureTypePatchHsv:
+        return new PatchHsvFeature(conf);
+    case Config::kFeatureTypePatchHsvG:
+        return new PatchHsvGFeature(conf);
+    case Config::kFeatureTypePatchRgb:
+        return new PatchRgbFeature(conf);
+    case Config::kFeatureTypePatchRgbG:
+        return new PatchRgbGFeature(conf);
+    default:
+        return 0;
+    }
+}
+
+static void benchFeatures(const cv::Mat& frame)
+{
+    const Config::FeatureType types[] = {
+        Config::kFeatureTypePatchGray, Config::kFeatureTypePatchRgb, Config::kFeatureTypePatchHsv,
+        Config::kFeatureTypePatchGrad, Config::kFeatureTypePatchGrayG, Config::kFeatureTypePatchRgbG,
+        Config::kFeatureTypePatchHsvG };
+    const char* names[] = { "patchGray", "patchRgb", "patchHsv", "patchGrad", "patchGrayGrad", "patchRgbGrad", "patchHsvGrad" };
+    const int sizes[] = { 32, 64, 128 };
+
+    Config conf;
+    conf.mPatchNumX = 7;
+    conf.mPatchNumY = 7;
+    for(int t=0; t<7; ++t)
+    {
+        std::unique_ptr<PatchFeature> feature(newFeature(types[t], conf));
+        const bool hsv = types[t] == Config::kFeatureTypePatchHsv || types[t] == Config::kFeatureTypePatchHsvG;
+        ImageRep image(frame, hsv, true);
+        for(int s=0; s<3; ++s)
+        {
+            std::vector<FloatRect> rects, kept;
+            PixelSamples(centredBox(sizes[s]), kSearchRadius, true, rects);
+            insideSamples(image, rects, kept);
+            multiSample samples(image, kept);
+            std::vector<Eigen::VectorXd> featVecs;
+            std::string param = std::to_string(sizes[s]) + "px";
+
+            report(std::string(names[t]) + " PrepEval", param,
+                   timeMedian([&]() { feature->Prepare(samples); }));
+            double ms = timeMedian([&]() { feature->EvalPrepared(samples, featVecs); });
+            report(std::string(names[t]) + " per sample", param, ms / kept.size());
+        }
+    }
+}
+
+// the dense score map of every patch feature against w.f of the feature
+// vectors of the same translations, for a random w
+static bool checkDenseScores(const cv::Mat& frame, Rng& rng)
+{
+    const Config::FeatureType types[] = {
+        Config::kFeatureTypePatchGray, Config::kFeatureTypePatchRgb, Config::kFeatureTypePatchHsv,
+        Config::kFeatureTypePatchGrad, Config::kFeatureTypePatchGrayG, Config::kFeatureTypePatchRgbG,
+        Config::kFeatureTypePatchHsvG };
+    const char* names[] = { "patchGray", "patchRgb", "patchHsv", "patchGrad", "patchGrayGrad", "patchRgbGrad", "patchHsvGrad" };
+    const int sizes[] = { 32, 64 };
+    const int radius = 12;
+
+    Config conf;
+    conf.mPatchNumX = 7;
+    conf.mPatchNumY = 7;
+    bool ok = true;
+    for(int t=0; t<7; ++t)
+    {
+        std::unique_ptr<PatchFeature> feature(newFeature(types[t], conf));
+        const bool hsv = types[t] == Config::kFeatureTypePatchHsv || types[t] == Config::kFeatureTypePatchHsvG;
+        ImageRep image(frame, hsv, true);
+        Eigen::VectorXd w(feature->GetCount());
+        for(int i=0; i<w.size(); ++i)
+            w[i] = rng.NextFloat(-1.f, 1.f);
+        for(int s=0; s<2; ++s)
+        {
+            // the search disk touches the image border, so some translations leave it
+            FloatRect centre(radius/2, kImageHeight/2, sizes[s], sizes[s]);
+            std::vector<FloatRect> corners;
+            corners.push_back(FloatRect(centre.XMin()-radius, centre.YMin()-radius, centre.Width(), centre.Height()));
+            corners.push_back(FloatRect(centre.XMin()+radius, centre.YMin()+radius, centre.Width(), centre.Height()));
+            feature->Prepare(multiSample(image, corners));
+            cv::Mat scoreMap;
+            feature->EvalDenseLinear(centre, radius, w, scoreMap);
+
+            std::vector<FloatRect> rects;
+            std::vector<double> denseScores;
+            for(int dy=-radius; dy<=radius; ++dy)
+            {
+                for(int dx=-radius; dx<=radius; ++dx)
+                {
+                    FloatRect r(centre.XMin()+dx, centre.YMin()+dy, centre.Width(), centre.Height());
+                    const double score = scoreMap.at<double>(radius+dy, radius+dx);
+                    if(r.IsInside(image.GetRect()) != (score != -DBL_MAX))
+                    {
+                        printf("check %s %dpx: translation (%d, %d) wrongly %s\n", names[t], sizes[s], dx, dy,
+                               score == -DBL_MAX ? "left out" : "scored");
+                        ok = false;
+                    }
+                    if(score == -DBL_MAX) continue;
+                    rects.push_back(r);
+                    denseScores.push_back(score);
+                }
+            }
+            std::vector<Eigen::VectorXd> featVecs;
+            feature->EvalPrepared(multiSample(image, rects), featVecs);
+            double maxErr = 0.0;
+            for(int i=0; i<(int)rects.size(); ++i)
+            {
+                double score = w.dot(featVecs[i]);
+                maxErr = std::max(maxErr, std::fabs(score - denseScores[i]) / std::max(1.0, std::fabs(score)));
+            }
+            if(maxErr > 1e-4)
+            {
+                printf("check %s %dpx: dense scores differ from w.f by %g\n", names[t], sizes[s], maxErr);
+                ok = false;
+            }
+        }
+    }
+    printf("%-28s %-16s %10s\n", "EvalDenseLinear == w.f", "", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// the adaptive search radius after every frame of a moving target, with the
+// bounded and with the exhaustive translation search
+static bool checkBoundedRadius(Rng& imageRng)
+{
+    const int kFrameNum = 6;
+    Config exhaustiveConf;
+    exhaustiveConf.mQuietMode = true;
+    exhaustiveConf.mPatchNumX = 7;
+    exhaustiveConf.mPatchNumY = 7;
+    exhaustiveConf.mFeatureKernelPair.mFeature = Config::kFeatureTypePatchGray;
+    exhaustiveConf.mFeatureKernelPair.mKernel = Config::kKernelTypeLinear;
+    exhaustiveConf.mScaleType = Config::kScaleTypeOne;
+    exhaustiveConf.mAdaptiveRadius = true;
+    exhaustiveConf.mSearchRadius = kSearchRadius;
+    Config boundedConf(exhaustiveConf);
+    boundedConf.mBoundedSearch = true;
+
+    Tracker exhaustive(exhaustiveConf);
+    Tracker bounded(boundedConf);
+    bool ok = true;
+    for(int f=0; f<kFrameNum; ++f)
+    {
+        // the target moves right, faster and faster
+        cv::Mat frame = syntheticImage((float)(f*f), 1.f, imageRng);
+        if(f == 0)
+        {
+            exhaustive.Initialise(frame, centredBox(64));
+            bounded.Initialise(frame, centredBox(64));
+            continue;
+        }
+        exhaustive.Track(frame);
+        bounded.Track(frame);
+        if(std::fabs(exhaustive.getSearchRadius() - bounded.getSearchRadius()) > 1e-3f)
+        {
+            printf("check frame %d: search radius %g with the bounded search, %g with the exhaustive one\n",
+                   f, bounded.getSearchRadius(), exhaustive.getSearchRadius());
+            ok = false;
+        }
+    }
+    printf("%-28s %-16s %10s\n", "bounded search radius", "", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static void benchKernels(Rng& rng)
+{
+    const int dims[] = { 256, 1024, 4096 };
+    const int kEvalNum = 1000;
+    LinearKernel linear;
+    IntersectionKernel intersection;
+    GaussianKernel gaussian(0.2);
+    Chi2Kernel chi2;
+    const Kernel* kernels[] = { &linear, &intersection, &gaussian, &chi2 };
+    const char* names[] = { "Kernel::Eval linear", "Kernel::Eval intersection", "Kernel::Eval gaussian", "Kernel::Eval chi2" };
+
+    for(int d=0; d<3; ++d)
+    {
+        Eigen::VectorXd x1(dims[d]), x2(dims[d]);
+        for(int i=0; i<dims[d]; ++i)
+        {
+            x1[i] = rng.NextFloat(0.f, 1.f);
+            x2[i] = rng.NextFloat(0.f, 1.f);
+        }
+        for(int k=0; k<4; ++k)
+        {
+            volatile double sink = 0.0;
+            double ms = timeMedian([&]() {
+                for(int i=0; i<kEvalNum; ++i)
+                    sink = sink + kernels[k]->Eval(x1, x2);
+            });
+            report(names[k], std::to_string(dims[d]) + "d", ms / kEvalNum);
+        }
+    }
+}
+
+static void benchSvmUpdate(Rng& imageRng)
+{
+    const int budgets[] = { 25, 50, 100 };
+    const int kUpdateNum = 60;
+    const FloatRect box = centredBox(64);
+
+    // the training samples of kUpdateNum frames of a target moving right
+    std::vector<cv::Mat> frames;
+    for(int f=0; f<kUpdateNum; ++f)
+        frames.push_back(syntheticImage((float)f, 1.f, imageRng));
+
+    for(int b=0; b<3; ++b)
+    {
+        Config conf;
+        conf.mQuietMode = true;
+        conf.mPatchNumX = 7;
+        conf.mPatchNumY = 7;
+        conf.mSvmC = 100.0;
+        conf.mSvmBudgetSize = budgets[b];
+        PatchGrayFeature feature(conf);
+        LinearKernel kernel;
+        Rng rng(0);
+        structuredSVM svm(conf, feature, kernel, rng);
+
+        std::vector<double> times;
+        for(int f=0; f<kUpdateNum; ++f)
+        {
+            ImageRep image(frames[f], false, true);
+            FloatRect bb(box);
+            bb.Translate((float)f, 0.f);
+            std::vector<FloatRect> rects, kept;
+            RadialSamples(bb, 2*kSearchRadius, 5, 16, rects);
+            kept.push_back(rects[0]);
+            for(int i=1; i<(int)rects.size(); ++i)
+            {
+                if(rects[i].IsInside(image.GetRect()))
+                    kept.push_back(rects[i]);
+            }
+            multiSample samples(image, kept);
+            std::vector<Eigen::VectorXd> featVecs;
+            feature.Eval(samples, featVecs);
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            svm.Update(samples, featVecs, 0);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        // once the budget is full
+        std::vector<double> steady(times.begin() + std::min(kUpdateNum/2, budgets[b]/2), times.end());
+        std::nth_element(steady.begin(), steady.begin() + steady.size()/2, steady.end());
+        report("structuredSVM::Update", "budget " + std::to_string(budgets[b]), steady[steady.size()/2]);
+    }
+}
+
+static void benchBinAndGradImages(const cv::Mat& frame)
+{
+    ImageRep image(frame, true, true);
+    const IntRect rect(kImageWidth/2 - 100, kImageHeight/2 - 100, 200, 200);
+
+    HsvFeature hsvFeature;
+    cv::Mat binImg = cv::Mat::zeros(frame.rows, frame.cols, CV_32SC1);
+    report("HsvFeature::getBinImg", "200x200", timeMedian([&]() {
+        hsvFeature.getBinImg(image.GetColorImage(), rect, binImg);
+    }));
+
+    GradFeature gradFeature;
+    cv::Mat orientation, magnitude;
+    report("GradFeature::compGrad", "200x200", timeMedian([&]() {
+        gradFeature.compGrad(image.GetGrayImage(), rect, orientation, magnitude);
+    }));
+}
+
+static void benchScaleEstimate(const cv::Mat& frame, const cv::Mat& scaledFrame)
+{
+    ImageRep prev(frame, false, false);
+    ImageRep curr(scaledFrame, false, false);
+
+    // 7x7 patches with 5 points each, as the tracker draws them
+    Config conf;
+    conf.mPatchNumX = 7;
+    conf.mPatchNumY = 7;
+    PatchGrayFeature feature(conf);
+    Rng rng(0);
+    std::vector<cv::Point2f> pts;
+    feature.extractPatchPts(centredBox(100), 5, rng, pts);
+
+    ScaleEstimator estimator;
+    estimator.initialize(prev.GetGrayImage(), pts);
+    float scale = 1.f;
+    double ms = timeMedian([&]() { scale = estimator.estimateScale(curr.GetGrayImage()); });
+    report("ScaleEstimator::estimate", std::to_string(pts.size()) + " pts", ms);
+    printf("%-28s %-16s %10.4f\n", "  estimated scale", "(true 1.03)", scale);
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc > 1)
+        gRepeats = std::max(1, atoi(argv[1]));
+
+    Rng rng(0);
+    cv::Mat frame = syntheticImage(0.f, 1.f, rng);
+    cv::Mat scaledFrame = syntheticImage(0.f, 1.03f, rng);
+
+    Rng checkRng(1);
+    if(!checkDenseScores(frame, checkRng) || !checkBoundedRadius(checkRng))
+        return EXIT_FAILURE;
+
+    benchFeatures(frame);
+    benchKernels(rng);
+    benchSvmUpdate(rng);
+    benchBinAndGradImages(frame);
+    benchScaleEstimate(frame, scaledFrame);
+
+    return EXIT_SUCCESS;
+}
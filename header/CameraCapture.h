@@ -0,0 +1,49 @@
+#ifndef CAMERA_CAPTURE_H
+#define CAMERA_CAPTURE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+// Captures the frames of a camera on its own thread and only keeps the latest
+// one, so that a tracker slower than the camera gets the freshest frame
+// instead of the oldest one queued in the driver. With a maximum age, frames
+// which got older than that while the tracker was busy are skipped as well,
+// and the next captured frame is waited for.
+class CameraCapture
+{
+public:
+    CameraCapture(int device, int maxAgeMs = 0);
+    ~CameraCapture();
+
+    inline bool IsOpened() const { return mCap.isOpened(); }
+    // waits for a frame newer than the last one read, false once the camera stopped
+    bool Read(cv::Mat& frame);
+
+    // frames captured, read and dropped (captured but never read) so far
+    int GetCaptured() const;
+    int GetRead() const;
+    int GetDropped() const;
+
+private:
+    void run();
+
+    cv::VideoCapture mCap;
+    int mMaxAgeMs;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCond;
+    cv::Mat mFrame;
+    std::chrono::steady_clock::time_point mFrameTime;
+    bool mFresh;   // mFrame was not read yet
+    bool mStop;
+    bool mEnded;
+    int mCaptured;
+    int mRead;
+    int mDropped;
+    std::thread mThread;
+};
+
+#endif
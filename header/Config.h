@@ -18,6 +18,21 @@ public:
         kScaleTypeAll
     };
 
+    enum InputType
+    {
+        kInputTypeImages,
+        kInputTypeVideo,
+        kInputTypeRawBgr,
+        kInputTypeRawYuv420,
+        kInputTypeCache
+    };
+
+    enum BudgetType
+    {
+        kBudgetTypeRemove,
+        kBudgetTypeMerge
+    };
+
     enum FeatureType
     {
         kFeatureTypeNone,
@@ -48,21 +63,43 @@ public:
     bool mQuietMode;
     bool mDebugMode;
     bool mUseCamera;
+    int mCameraMaxAge;
     bool mSaveFrame;
     bool mSaveBB;
     bool mPrecision;
+    bool mTimeStages;
     std::string mSeqBasePath;
     std::vector<std::string> mSeqNames;
     std::string mSeqName;
     std::string mBbFileName;
     std::string mPrecFileName;
+    std::string mTimesFileName;
+    InputType mInputType;
+    std::string mInputFile;
+    int mRawWidth;
+    int mRawHeight;
+    int mDecodeThreads;
+    bool mDeinterlace;
+    std::string mTargetsFile;
 
     int mSeed;
     double mSvmC;
     int mSvmBudgetSize;
+    BudgetType mSvmBudgetType;
+    int mSvmThreads;
     int mPatchNumX;
     int mPatchNumY;
     float mSearchRadius;
+    int mMaxTargetArea;
+    int mSearchStride;
+    int mSearchTopK;
+    bool mDenseSearch;
+    bool mAdaptiveRadius;
+    bool mBoundedSearch;
+    bool mWindowedImage;
+    bool mSubPixel;
+    bool mAsyncUpdate;
+    int mUpdateStaleness;
     FeatureKernelPair mFeatureKernelPair;
     ScaleType mScaleType;
     std::string rectFilePath;
@@ -74,6 +111,8 @@ private:
     static std::string FeatureName(FeatureType f);
     static std::string KernelName(kernelType k);
     static std::string ScaleName(ScaleType s);
+    static std::string BudgetName(BudgetType b);
+    static std::string InputName(InputType i);
 
 };
 
@@ -7,6 +7,7 @@
 
 class Sample;
 class multiSample;
+class StageTimes;
 
 class Feature
 {
@@ -20,10 +21,12 @@ public:
         return mFeatVec;
     }
     virtual void Eval(const multiSample& samples, std::vector<Eigen::VectorXd>& featVecs);
+    inline void SetStageTimes(StageTimes* times) { mTimes = times; }
 
 protected:
     int mFeatureCount;
     Eigen::VectorXd mFeatVec;
+    StageTimes* mTimes;
 
     void SetCount(int c);
     virtual void UpdateFeatureVector(const Sample& s)=0;
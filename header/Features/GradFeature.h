@@ -3,6 +3,8 @@
 #include <opencv2/opencv.hpp>
 #include "Rect.h"
 
+class ImageRep;
+
 class GradFeature
 {
 public:
@@ -12,6 +14,11 @@ public:
     int compBinIdx(const float orientation) const;
     void compGrad(const cv::Mat& img, const IntRect& rect,
                   cv::Mat& orientation, cv::Mat & mag) const;
+    // from the derivatives of image if it has them
+    void compGrad(const ImageRep& image, const IntRect& rect,
+                  cv::Mat& orientation, cv::Mat& mag) const;
+    void compGradFromSobel(const cv::Mat& xSobel, const cv::Mat& ySobel, const IntRect& rect,
+                           cv::Mat& orientation, cv::Mat& mag) const;
 private:
     int mBinNum;
     float mBinStep;
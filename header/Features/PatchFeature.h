@@ -4,6 +4,9 @@
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include "Features/Feature.h"
+#include "StageTimer.h"
+
+class Rng;
 
 
 static const float kAlpha = 0.1;
@@ -19,19 +22,43 @@ public:
     }
     virtual void Eval(const multiSample& samples, std::vector<Eigen::VectorXd>& featVecs);
     virtual void UpdateWeightModel(const Sample& s)=0;
+    inline const Eigen::VectorXd& GetPatchWeights() const { return mPatchWeights; }
+    inline void SetPatchWeights(const Eigen::VectorXd& weights) { mPatchWeights = weights; }
+
+    // prepare the feature maps once for the region covered by samples, later
+    // samples inside that region can then be evaluated with EvalPrepared
+    inline void Prepare(const multiSample& samples) { ScopedTimer timer(mTimes, kStagePrepEval); PrepEval(samples); }
+    inline void EvalPrepared(const multiSample& samples, std::vector<Eigen::VectorXd>& featVecs) { Feature::Eval(samples, featVecs); }
 
     cv::Mat getPatchWeightImg(const FloatRect &bb);
     cv::Mat getPatchWeightFrame(const cv::Mat& frame, const FloatRect& bb);
     void showPatchWeightFrame(const cv::Mat& frame, const int frame_idx, const FloatRect& bb);
     void showPatchWeightImg(const int frame_idx, const FloatRect &bb);
 
-    void extractPatchPts(const FloatRect& bb, const int ptNumPerPatch, std::vector<cv::Point2f>& pts);
+    void extractPatchPts(const FloatRect& bb, const int ptNumPerPatch, Rng& rng, std::vector<cv::Point2f>& pts);
+
+    void EvalDenseLinear(const FloatRect& centre, int radius, const Eigen::VectorXd& w, cv::Mat& scoreMap);
+    int EvalBoundedLinear(const multiSample& samples, const Eigen::VectorXd& w, int exactStride, std::vector<double>& scores);
 
 protected:
     virtual void PrepEval(const multiSample& samples){}
     void setPatchRect(const cv::Size& sample_size);
     virtual void UpdateFeatureVector(const Sample& s)=0;
 
+    // bins which UpdateFeatureVector normalizes together, with the weight of the
+    // group in the normalized feature vector (linear kernel)
+    struct BinGroup
+    {
+        BinGroup(int start, int count, double weight) : start(start), count(count), weight(weight) {}
+        int start;
+        int count;
+        double weight;
+    };
+
+    int mBinNum;
+    std::vector<cv::Mat> mIntegs;
+    std::vector<BinGroup> mBinGroups;
+
     int mPatchNumX;
     int mPatchNumY;
     std::vector<IntRect> mPatchRects;
@@ -15,12 +15,10 @@ private:
     void PrepEval(const multiSample& samples);
     void UpdateFeatureVector(const Sample& s);
 
-    int mBinNum;
     Config::kernelType mKernelType;
 
     GradFeature mGradFeature;
 
-    std::vector<cv::Mat> mIntegs;
     cv::Mat mWeightInteg;
 
 };
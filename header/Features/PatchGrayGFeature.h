@@ -18,14 +18,12 @@ private:
 
     int mGrayBinNum;
     int mGradBinNum;
-    int mBinNum;
     Config::kernelType mKernelType;
 
     GrayFeature mGrayFeature;
     GradFeature mGradFeature;
     segModel mWeightModel;
 
-    std::vector<cv::Mat> mIntegs;
     cv::Mat mWeightInteg;
 
     double mGrayWeight;
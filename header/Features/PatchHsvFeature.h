@@ -15,13 +15,11 @@ private:
     void PrepEval(const multiSample& samples);
     void UpdateFeatureVector(const Sample& s);
 
-    int mBinNum;
     Config::kernelType mKernelType;
 
     HsvFeature mHsvFeature;
     segModel mWeightModel;
 
-    std::vector<cv::Mat> mIntegs;
     cv::Mat mWeightInteg;
 
 };
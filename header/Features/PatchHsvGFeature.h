@@ -19,14 +19,12 @@ private:
 
     int mHsvBinNum;
     int mGradBinNum;
-    int mBinNum;
     Config::kernelType mKernelType;
 
     HsvFeature mHsvFeature;
     GradFeature mGradFeature;
     segModel mWeightModel;
 
-    std::vector<cv::Mat> mIntegs;
     cv::Mat mWeightInteg;
 
     double mColorWeight;
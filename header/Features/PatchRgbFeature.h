@@ -14,13 +14,11 @@ private:
     void UpdateFeatureVector(const Sample& s);
     void PrepEval(const multiSample& samples);
 
-    int mBinNum;
     Config::kernelType mKernelType;
 
     RgbFeature mRgbFeature;
     segModel mWeightModel;
 
-    std::vector<cv::Mat> mIntegs;
     cv::Mat mWeightInteg;
 
 };
@@ -18,7 +18,6 @@ private:
 
     int mRgbBinNum;
     int mGradBinNum;
-    int mBinNum;
     Config::kernelType mKernelType;
 
     RgbFeature mRgbFeature;
@@ -26,7 +25,6 @@ private:
 
     segModel mWeightModel;
 
-    std::vector<cv::Mat> mIntegs;
     cv::Mat mWeightInteg;
 
     double mColorWeight;
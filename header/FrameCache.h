@@ -0,0 +1,78 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <opencv2/opencv.hpp>
+#include "FrameSource.h"
+
+class Config;
+
+// Header of a frame cache file: the decoded, scaled (and deinterlaced) frames
+// of a sequence, stored one after another right behind the header.
+struct FrameCacheHeader
+{
+    char mMagic[8];
+    int32_t mVersion;
+    int32_t mWidth;       // of the scaled frames
+    int32_t mHeight;
+    int32_t mType;        // OpenCV type of the frames
+    int32_t mStartFrame;  // index of the first frame in the sequence
+    int32_t mFrameNum;
+    float mScaleW;        // scale factors from the original frames
+    float mScaleH;
+    int32_t mReserved[6];
+};
+
+// Writes the frames of a sequence to a cache file.
+class FrameCacheWriter
+{
+public:
+    FrameCacheWriter(const std::string& path, int startFrame, float scaleW, float scaleH);
+    ~FrameCacheWriter();
+
+    inline bool IsOpened() const { return mFile.is_open(); }
+    // frames after the first have the size and type of the first one
+    bool Write(const cv::Mat& frame);
+    // completes the header, false if the file could not be written
+    bool Close();
+
+private:
+    std::ofstream mFile;
+    FrameCacheHeader mHeader;
+};
+
+// The frames of a cache file, memory mapped. Frames are read without a copy
+// and must not be written to.
+class FrameCacheSource : public FrameSource
+{
+public:
+    FrameCacheSource(const std::string& path);
+
+    bool Read(int frameInd, cv::Mat& frame);
+    inline bool IsRandomAccess() const { return true; }
+    inline bool IsPrepared() const { return true; }
+    inline float GetScaleW() const { return mHeader.mScaleW; }
+    inline float GetScaleH() const { return mHeader.mScaleH; }
+    inline bool IsOpened() const { return mData != 0; }
+    inline int GetStartFrame() const { return mHeader.mStartFrame; }
+    inline int GetFrameNum() const { return mHeader.mFrameNum; }
+
+    // the cache file of the current sequence of conf
+    static std::string GetPath(const Config& conf);
+
+private:
+    bool checkHeader(size_t dataBytes);
+
+    std::unique_ptr<boost::interprocess::file_mapping> mFileMapping;
+    std::unique_ptr<boost::interprocess::mapped_region> mRegion;
+    FrameCacheHeader mHeader;
+    const unsigned char* mData;
+    size_t mFrameBytes;
+};
+
+#endif
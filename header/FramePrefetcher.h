@@ -0,0 +1,53 @@
+#ifndef FRAME_PREFETCHER_H
+#define FRAME_PREFETCHER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+class FrameSource;
+
+// Reads, deinterlaces and scales the frames of a sequence ahead of the tracker
+// on worker threads (a single one for sequential sources). The frames are
+// handed out in order from a ring buffer, workers never get further than its
+// capacity ahead of the reader.
+class FramePrefetcher
+{
+public:
+    FramePrefetcher(FrameSource& source, int startFrame, int endFrame,
+                    float scaleW, float scaleH, bool deinterlace, int interpolation, int workerNum);
+    ~FramePrefetcher();
+
+    // the next frame as read and after preprocessing, false after the last
+    // frame; frameOrig is empty if the frame could not be read
+    bool Next(cv::Mat& frameOrig, cv::Mat& frame);
+
+private:
+    struct Slot
+    {
+        bool ready;
+        cv::Mat orig;
+        cv::Mat scaled;
+    };
+
+    void run();
+
+    FrameSource& mSource;
+    int mEndFrame;
+    float mScaleW;
+    float mScaleH;
+    bool mDeinterlace;
+    int mInterpolation;
+
+    std::vector<Slot> mSlots;
+    int mNextRead;     // frame handed out next
+    int mNextDecode;   // frame decoded next
+    bool mStop;
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    std::vector<std::thread> mWorkers;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+class Config;
+
+// Source of the frames of a sequence, frames are addressed by their index in
+// the sequence (the first frame of a video or stream has index firstFrame).
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    // false if the frame could not be read; sequential sources only support
+    // increasing indices and skip the frames in between
+    virtual bool Read(int frameInd, cv::Mat& frame) = 0;
+    // whether frames can be read concurrently and in any order
+    virtual bool IsRandomAccess() const { return false; }
+    // whether the frames are already prepared (scaled by GetScaleW and GetScaleH)
+    virtual bool IsPrepared() const { return false; }
+    virtual float GetScaleW() const { return 1.f; }
+    virtual float GetScaleH() const { return 1.f; }
+
+    // the source of the current sequence of conf, 0 if it cannot be opened
+    static FrameSource* Create(const Config& conf, int firstFrame);
+};
+
+// numbered image files, e.g. sequences/<name>/img/%04d.jpg
+class ImageFileSource : public FrameSource
+{
+public:
+    ImageFileSource(const std::string& format) : mFormat(format) {}
+
+    bool Read(int frameInd, cv::Mat& frame);
+    inline bool IsRandomAccess() const { return true; }
+    std::string GetPath(int frameInd) const;
+
+private:
+    std::string mFormat;
+};
+
+// any video file cv::VideoCapture can decode
+class VideoFileSource : public FrameSource
+{
+public:
+    VideoFileSource(const std::string& path, int firstFrame);
+
+    bool Read(int frameInd, cv::Mat& frame);
+    inline bool IsOpened() const { return mCap.isOpened(); }
+
+private:
+    std::mutex mMutex;
+    cv::VideoCapture mCap;
+    int mNextFrame;
+};
+
+// headerless stream of fixed size BGR or planar YUV 4:2:0 (I420) frames from
+// a file or a pipe ("-" is the standard input)
+class RawStreamSource : public FrameSource
+{
+public:
+    RawStreamSource(const std::string& path, int width, int height, bool yuv, int firstFrame);
+    ~RawStreamSource();
+
+    bool Read(int frameInd, cv::Mat& frame);
+    inline bool IsOpened() const { return mFile != 0; }
+
+private:
+    std::mutex mMutex;
+    FILE* mFile;
+    int mWidth;
+    int mHeight;
+    bool mYuv;
+    int mNextFrame;
+    cv::Mat mBuffer;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef FRAME_TRACKER_H
+#define FRAME_TRACKER_H
+
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include "Config.h"
+#include "Rect.h"
+
+class Tracker;
+
+// Tracker of one target in full size frames, the API of the pawss library.
+// Scales the frames for the tracker and reports the target in frame
+// coordinates. It owns a copy of its config, so a process can run any number
+// of them, e.g. one per stream.
+class FrameTracker
+{
+public:
+    FrameTracker(const Config& conf);
+    ~FrameTracker();
+
+    // start tracking bb (in frame coordinates) from the first frame; the frames
+    // passed in are never changed, the config's deinterlace works on a copy
+    void Initialise(const cv::Mat& frame, const FloatRect& bb);
+    // from the first frame already prepared with the scale factors of GetFrameScale for bb
+    void InitialisePrepared(const cv::Mat& frame, const FloatRect& bb);
+    // 8-bit BGR frame buffer of width x height pixels, rows stride bytes apart
+    void Initialise(const unsigned char* data, int width, int height, int stride, const FloatRect& bb);
+    // the target in the next frame
+    const FloatRect& Track(const cv::Mat& frame);
+    const FloatRect& Track(const unsigned char* data, int width, int height, int stride);
+    // the target in the next frame, already scaled with PrepareFrame (e.g. on a decode thread)
+    const FloatRect& TrackPrepared(const cv::Mat& frame);
+    void PrepareFrame(const cv::Mat& frameOrig, cv::Mat& frame) const;
+    // the factors the frames are scaled by for the target bb
+    static void GetFrameScale(const Config& conf, const FloatRect& bb, float& scaleW, float& scaleH);
+    // the OpenCV interpolation the frames are scaled with by these factors
+    static int GetFrameInterpolation(const Config& conf, float scaleW, float scaleH);
+    // stop tracking, the stage times of the tracker stay available
+    void Reset();
+
+    inline bool IsInitialised() const { return mInitialised; }
+    inline const FloatRect& GetBB() const { return mBb; }
+    inline float GetScaleW() const { return mScaleW; }
+    inline float GetScaleH() const { return mScaleH; }
+    inline int GetInterpolation() const { return GetFrameInterpolation(mConfig, mScaleW, mScaleH); }
+    // the last frame as scaled for the tracker
+    inline const cv::Mat& GetFrame() const { return mFrame; }
+    // the tracker on the scaled frames, 0 before the first Initialise
+    inline Tracker* GetTracker() { return mTracker.get(); }
+    inline const Config& GetConfig() const { return mConfig; }
+
+private:
+    void initialise(const FloatRect& bb);
+
+    Config mConfig;
+    std::unique_ptr<Tracker> mTracker;
+    bool mInitialised;
+    float mScaleW;
+    float mScaleH;
+    cv::Mat mFrame;
+    FloatRect mBb;
+};
+
+#endif
@@ -7,22 +7,35 @@
 class ImageRep
 {
 public:
+    // grad also computes the Sobel derivatives of the gray image
     ImageRep(const cv::Mat &image, bool hsv_flag,
-             bool color=true);
+             bool color=true, bool grad=false);
+    // only the window of the frame, with its top left corner as origin
+    ImageRep(const cv::Mat &frame, const IntRect &window, bool hsv_flag,
+             bool color=true, bool grad=false);
+    // view of the window (in the coordinates of image) of all images of image, nothing is copied
+    ImageRep(const ImageRep &image, const IntRect &window);
 
     inline const cv::Mat& GetImage(int channel = 0) const { return mImgs[channel]; }
     inline const cv::Mat& GetBaseImage() const { return mBaseImg; }
     inline const cv::Mat& GetGrayImage() const { return mGrayImg; }
     inline const cv::Mat& GetColorImage() const { return mColorImg; }
+    inline bool HasGradients() const { return !mGradX.empty(); }
+    inline const cv::Mat& GetGradX() const { return mGradX; }
+    inline const cv::Mat& GetGradY() const { return mGradY; }
     inline const IntRect& GetRect() const { return mRect; }
+    inline const cv::Point& GetOrigin() const { return mOrigin; }
 
 private:
     cv::Mat mBaseImg;
     cv::Mat mColorImg;
     cv::Mat mGrayImg;
     std::vector<cv::Mat> mImgs;
+    cv::Mat mGradX;
+    cv::Mat mGradY;
     int mChannels;
     IntRect mRect;
+    cv::Point mOrigin;
 
 
 };
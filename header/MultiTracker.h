@@ -0,0 +1,61 @@
+#ifndef MULTI_TRACKER_H
+#define MULTI_TRACKER_H
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "Config.h"
+#include "Rect.h"
+
+class Tracker;
+class WorkerPool;
+
+// Tracker of several targets in the same frames. Every frame is scaled once
+// and its image representations (colour conversion, channels, gray image and
+// gradients) are computed once for the union of the search windows of the
+// targets, then the targets are tracked in parallel on views of them, on
+// threads which live as long as the targets.
+class MultiTracker
+{
+public:
+    MultiTracker(const Config& conf);
+    ~MultiTracker();
+
+    // start tracking bbs (in frame coordinates) from the first frame, which is
+    // not changed, like in FrameTracker
+    void Initialise(const cv::Mat& frame, const std::vector<FloatRect>& bbs);
+    // the targets in the next frame
+    const std::vector<FloatRect>& Track(const cv::Mat& frame);
+    // the targets in the next frame, already scaled with PrepareFrame
+    const std::vector<FloatRect>& TrackPrepared(const cv::Mat& frame);
+    void PrepareFrame(const cv::Mat& frameOrig, cv::Mat& frame) const;
+    void Reset();
+
+    inline bool IsInitialised() const { return mInitialised; }
+    inline int GetTargetNum() const { return mTrackers.size(); }
+    inline const std::vector<FloatRect>& GetBBs() const { return mBBs; }
+    inline float GetScaleW() const { return mScaleW; }
+    inline float GetScaleH() const { return mScaleH; }
+    int GetInterpolation() const;
+    // the last frame as scaled for the trackers
+    inline const cv::Mat& GetFrame() const { return mFrame; }
+    inline Tracker* GetTracker(int i) { return mTrackers[i].get(); }
+
+private:
+    void addImageRepTime(std::chrono::steady_clock::time_point start);
+
+    Config mConfig;
+    // the targets differ in their search radius, every tracker keeps a reference to its config
+    std::vector<std::unique_ptr<Config> > mConfigs;
+    std::vector<std::unique_ptr<Tracker> > mTrackers;
+    // a worker for every target but the first, which is tracked on the calling thread
+    std::unique_ptr<WorkerPool> mPool;
+    bool mInitialised;
+    float mScaleW;
+    float mScaleH;
+    cv::Mat mFrame;
+    std::vector<FloatRect> mBBs;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef RNG_H
+#define RNG_H
+#include <stdint.h>
+
+// Small PCG32 random number generator. Each tracker owns one, so trackers
+// running in the same process neither share state nor disturb each other's
+// sequences.
+class Rng
+{
+public:
+    Rng(uint64_t seed = 0) { Seed(seed); }
+
+    inline void Seed(uint64_t seed)
+    {
+        mState = 0;
+        Next();
+        mState += seed;
+        Next();
+    }
+
+    // uniform in [0, 2^32)
+    inline uint32_t Next()
+    {
+        uint64_t old = mState;
+        mState = old * 6364136223846793005ULL + kInc;
+        uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = (uint32_t)(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+
+    // uniform in [0, n)
+    inline int NextInt(int n) { return (int)(((uint64_t)Next() * (uint64_t)n) >> 32); }
+
+    // uniform in [a, b)
+    inline float NextFloat(float a, float b) { return a + (b - a) * (float)(Next() >> 8) * (1.f / 16777216.f); }
+
+private:
+    static const uint64_t kInc = 1442695040888963407ULL;
+    uint64_t mState;
+};
+
+#endif
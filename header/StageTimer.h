@@ -0,0 +1,64 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum Stage
+{
+    kStageImageRep,
+    kStagePrepEval,
+    kStageFeatureVectors,
+    kStageEvalSamples,
+    kStageScaleEstimate,
+    kStageSvmProcessNew,
+    kStageSvmReprocess,
+    kStageSvmBudget,
+    kStageWeightModel,
+    kStageNum
+};
+
+// Durations of the stages of one tracker, recorded from any thread.
+class StageTimes
+{
+public:
+    void Add(Stage stage, double ms);
+    void Clear();
+    // per stage: count, mean, p50, p95, p99 and max in milliseconds
+    bool Write(const std::string& filePath) const;
+
+    static std::string StageName(Stage stage);
+
+private:
+    mutable std::mutex mMutex;
+    std::vector<double> mTimes[kStageNum];
+};
+
+// Adds the lifetime of the timer to the stage, costs a branch if times is 0.
+class ScopedTimer
+{
+public:
+    inline ScopedTimer(StageTimes* times, Stage stage) : mTimes(times), mStage(stage)
+    {
+        if(mTimes)
+            mStart = std::chrono::steady_clock::now();
+    }
+    inline ~ScopedTimer() { Stop(); }
+
+    // ends the stage before the end of the scope
+    inline void Stop()
+    {
+        if(mTimes)
+            mTimes->Add(mStage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count());
+        mTimes = 0;
+    }
+
+private:
+    StageTimes* mTimes;
+    Stage mStage;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+#endif
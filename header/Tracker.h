@@ -1,8 +1,16 @@
 #ifndef TRACKER_H
 #define TRACKER_H
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <opencv/cv.h>
 #include <opencv2/highgui.hpp>
 #include "Rect.h"
+#include "Rng.h"
+#include "StageTimer.h"
 
 class Config;
 class ImageRep;
@@ -11,6 +19,7 @@ class Kernel;
 class structuredSVM;
 class Sample;
 class ScaleEstimator;
+class WorkerPool;
 
 
 class Tracker
@@ -20,9 +29,15 @@ public:
     ~Tracker();
 
     void Initialise(const cv::Mat& frame, const FloatRect& bb);
+    // frameImage is the whole frame, with the image types of needHsv, needColor and needGrad
+    void Initialise(const ImageRep& frameImage, const FloatRect& bb);
     void Reset();
     void Debug(const cv::Mat frame, const int frameIdx);
     void Track(const cv::Mat &frame);
+    // frameImage covers at least GetSearchWindow() of the frame, e.g. shared between trackers
+    void Track(const ImageRep& frameImage);
+    // the part of the frame the next Track reads
+    IntRect GetSearchWindow() const;
     void UpdateClassifier(const ImageRep& image);
     void UpdateWeightModel(const Sample& s);
     void UpdateDebugImage(const std::vector<FloatRect>& samples, const FloatRect& centre, const std::vector<double>& scores);
@@ -30,30 +45,85 @@ public:
     inline bool isInitialised() const {return mInitialised; }
     inline const FloatRect& getBB() const { return mBb; }
     inline const float getScale() const { return mScale; }
+    // the radius of the next translation search
+    inline float getSearchRadius() const { return mSearchRadius; }
+    inline bool needHsv() const { return mNeedHsv; }
+    inline bool needColor() const { return mNeedColor; }
+    inline bool needGrad() const { return mNeedGrad; }
+    // stage durations since Initialise, complete after Reset
+    inline const StageTimes& getStageTimes() const { return mTimes; }
+    // the times to record stages run outside the tracker in, 0 unless timeStages
+    inline StageTimes* getStageTimer() { return mStageTimes; }
 private:
 
+    PatchFeature* newFeature();
+    void trainClassifier(const ImageRep& image, const FloatRect& bb, float scale, PatchFeature& feature);
+    void updateModel(const ImageRep& image, const FloatRect& bb);
+    void startUpdates();
+    void stopUpdates();
+    void runUpdates();
+    void publishModel();
+
+    void trackImage(const ImageRep& image);
+    void searchTranslation(const ImageRep& image, const FloatRect& searchBb, std::vector<FloatRect>& keptRects, std::vector<double>& scores);
+    FloatRect getSearchBb() const;
+    IntRect getSearchWindow(const FloatRect& searchBb, const cv::Size& frameSize) const;
     void genOneScaleBBs(const ImageRep& img, const FloatRect& centre, std::vector<FloatRect>& keptRects);
+    void prepareSearchDisk(const ImageRep& img, const FloatRect& centre, int radius);
+    void searchDense(const ImageRep& img, const FloatRect& centre, std::vector<FloatRect>& keptRects, std::vector<double>& scores);
+    void searchCoarseToFine(const ImageRep& img, const FloatRect& centre, std::vector<FloatRect>& keptRects, std::vector<double>& scores);
     void genGradualScaleBBs(const ImageRep& img, const FloatRect& centre, std::vector<FloatRect>& rects);
     void genAllScaleBBs(const ImageRep& img, const FloatRect& centre, const float scale, std::vector<FloatRect>& rects);
+    void genScaleSpaceBBs(const ImageRep& img, const FloatRect& centre, const std::vector<float>& scales,
+                          const std::vector<float>& minRatios, std::vector<FloatRect>& rects);
+
+    void updateMotionModel(const FloatRect& searchBb, const FloatRect& bestBb, const std::vector<double>& scores, int bestInd);
 
     void getBestBB(const std::vector<double>& scores, int &bestInd);
+    FloatRect refineSubPixel(const std::vector<FloatRect>& rects, const std::vector<double>& scores, int bestInd) const;
     void getBestBB(const std::vector<FloatRect>& rects, const std::vector<double>& scores, int &bestInd);
     const Config& mConfig;
+    Rng mRng;
     bool mInitialised;
     cv::Mat mDebugImage;
 
     bool mNeedColor;
     bool mNeedHsv;
+    bool mNeedGrad;
+    cv::Size mFrameSize;
 
     FloatRect mInitBb;
     FloatRect mBb;
+
+    // constant velocity motion model for the translation search
+    float mSearchRadius;
+    cv::Point2f mVelocity;
+    float mInnovation;
+
     structuredSVM* mClassifier;
     PatchFeature* mFeature;
     Kernel* mKernel;
 
+    // asynchronous model update: the classifier and mUpdateFeature learn from a
+    // frame on mUpdateThread, while the next frames are localized with mFeature
+    // and the classifier model published after the last finished update
+    PatchFeature* mUpdateFeature;
+    Rng mUpdateRng;
+    std::thread mUpdateThread;
+    std::mutex mUpdateMutex;
+    std::condition_variable mUpdateCond;
+    std::deque<std::function<void()> > mUpdateJobs;
+    int mPendingUpdates;
+    bool mStopUpdates;
+
     float mScale;
     std::vector<float> mScales;
     ScaleEstimator* mScaleEstimator;
+    // estimates the scale of a frame during its translation search, with kScaleTypeAll
+    std::unique_ptr<WorkerPool> mScalePool;
+
+    StageTimes mTimes;
+    StageTimes* mStageTimes;  // 0 unless timeStages
 
 };
 
@@ -0,0 +1,38 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads that live as long as the pool and run the tasks of one Run call at a
+// time, so that short parallel loops do not pay for starting threads.
+class WorkerPool
+{
+public:
+    WorkerPool(int workerNum);
+    ~WorkerPool();
+
+    // run f(0), ..., f(n-1) and return when all are done; f(0) runs on the
+    // calling thread, f(t) on worker (t-1) % workerNum
+    void Run(int n, const std::function<void(int)>& f);
+    inline int GetWorkerNum() const { return mWorkerNum; }
+
+private:
+    void run(int worker);
+
+    int mWorkerNum;
+    const std::function<void(int)>* mTask;
+    int mTaskNum;
+    int mGeneration;   // incremented by every Run
+    int mPending;      // workers not done with the current Run
+    bool mStop;
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    std::condition_variable mDoneCond;
+    std::vector<std::thread> mWorkers;
+};
+
+#endif
@@ -13,10 +13,10 @@ void rectangle(const cv::Mat& rMat, const FloatRect& rRect, const cv::Scalar& rC
 void RadialSamples(const FloatRect& centre, int radius, int nr, int nt, std::vector<FloatRect>& rects);
 void PixelSamples(const FloatRect& centre, int radius, bool half, std::vector<FloatRect>& rects);
 
-void scaleFrame(const float rWidth, const float rHeight, float& scaleWidth, float& scaleHeight);
-void deinterlace(cv::Mat& m);
+void scaleFrame(const float rWidth, const float rHeight, float& scaleWidth, float& scaleHeight, const int maxArea = 0);
+void deinterlace(const cv::Mat& src, cv::Mat& dst);
+void prepareFrame(const cv::Mat& frameOrig, float scaleW, float scaleH, bool deinterlaceFrame, int interpolation, cv::Mat& frame);
 float mod(float a, float b);
-float RandomFloat(float a, float b);
 void getUnionRect(const std::vector<FloatRect> &rects, FloatRect& union_r);
 cv::Mat colorMap(const cv::Mat& img);
 
@@ -8,16 +8,18 @@ class ScaleEstimator
 public:
     ~ScaleEstimator();
 
-    void initialize(const cv::Mat& prevImg, const std::vector<cv::Point2f>& prevPts);
-    void update(const cv::Mat& prevImg, const std::vector<cv::Point2f>& prevPts);
-    float estimateScale(const cv::Mat& currImg);
+    // images may be windows of the frames, given by the origin of their coordinates
+    void initialize(const cv::Mat& prevImg, const std::vector<cv::Point2f>& prevPts, const cv::Point& origin = cv::Point(0, 0));
+    void update(const cv::Mat& prevImg, const std::vector<cv::Point2f>& prevPts, const cv::Point& origin = cv::Point(0, 0));
+    float estimateScale(const cv::Mat& currImg, const cv::Point& origin = cv::Point(0, 0));
     inline void setPrevPts(const std::vector<cv::Point2f>& pts) { mPrevPts = pts; }
     inline void setPrevImg(const cv::Mat& img) { mPrevImg = img.clone(); }
     inline int getPtNum() const { return mPrevPts.size(); }
 
 private:
-    void trackPts(const cv::Mat& currImg);
+    void trackPts(const cv::Mat& currImg, const cv::Point& origin);
     cv::Mat mPrevImg;
+    cv::Point mPrevOrigin;
     std::vector<cv::Point2f> mPrevPts;
     std::vector<cv::Point2f> mCurrPts;
     std::vector<uchar> mStatus;
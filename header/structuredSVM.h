@@ -1,6 +1,8 @@
 #ifndef STRUCTUREDSVM_H
 #define STRUCTUREDSVM_H
 
+#include <functional>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <Eigen/Core>
 #include "Rect.h"
@@ -10,12 +12,19 @@ class Feature;
 class Kernel;
 class Sample;
 class multiSample;
+class Rng;
+class StageTimes;
+class WorkerPool;
 
+// x and loss may hold more entries than yv: the extra ones are vectors
+// synthesized by budget merging, which are never candidate outputs.
 struct SupportPattern
 {
     std::vector<Eigen::VectorXd> x;
     std::vector<FloatRect> yv;
+    std::vector<double> loss;  // loss of each yv against the true yv[y]
     std::vector<cv::Mat> images;
+    std::vector<int> freeSlots;  // synthesized entries of removed svs
     int y;
     int refCount;
 };
@@ -32,12 +41,19 @@ struct SupportVector
 class structuredSVM
 {
 public:
-    structuredSVM(const Config& conf, const Feature &feature, const Kernel& kernel);
+    structuredSVM(const Config& conf, const Feature &feature, const Kernel& kernel, Rng& rng);
     ~structuredSVM();
     void Update(const multiSample& samples, const std::vector<Eigen::VectorXd>& featVecs, int y);
     void Debug();
     void EvalMultiSamples(const std::vector<Eigen::VectorXd>& fvs, std::vector<double>& scores) const;
     double EvalTrueSample(const Eigen::VectorXd& tfv) const;
+    inline const Eigen::VectorXd& GetW() const { return mDoubleBuffered ? mWFront : mW; }
+
+    // with a double buffered model, the Eval functions and GetW use the model as
+    // of the last Publish, and Update may run concurrently with them
+    void SetDoubleBuffered(bool doubleBuffered);
+    void Publish();
+    inline void SetStageTimes(StageTimes* times) { mTimes = times; }
 
 //    inline const Feature& getFeature() const {return mFeature; }
 
@@ -50,6 +66,11 @@ private:
     void Reprocess();
     void ProcessOld();
     void Optimize();
+    void ReprocessParallel(int numThreads);
+    void SMOStepDelta(int ipos, int ineg, std::vector<double>& dg);
+    void OptimizeDelta(const SupportPattern* sp, std::vector<double>& dg);
+    void RemoveZeroSupportVectors();
+    void parallelRun(int n, const std::function<void(int)>& f);
 
     int AddSupportVector(SupportPattern* x, int y, double g);
     void RemoveSupportVector(int ind);
@@ -57,8 +78,11 @@ private:
 
     void BudgetMaintenance();
     void BudgetMaintenanceRemove();
+    void BudgetMaintenanceMerge();
+    void ResizeKernelMatrix(int N);
 
     double Evaluate(const Eigen::VectorXd& x) const;
+    double EvaluateFront(const Eigen::VectorXd& x) const;
     double Test(const Eigen::VectorXd& x) const;
 
     void UpdateDebugImage();
@@ -70,9 +94,18 @@ private:
     Eigen::VectorXd mW;
     double mC;
 
+    // published model: w and the (beta, x) of the support vectors
+    bool mDoubleBuffered;
+    Eigen::VectorXd mWFront;
+    std::vector<double> mFrontB;
+    std::vector<Eigen::VectorXd> mFrontX;
+
     const Config& mConfig;
 //    const Feature& mFeature;
     const Kernel& mKernel;
+    Rng& mRng;
+    StageTimes* mTimes;
+    std::unique_ptr<WorkerPool> mPool;
 
 
 
@@ -0,0 +1,98 @@
+#include "CameraCapture.h"
+
+CameraCapture::CameraCapture(int device, int maxAgeMs) :
+    mCap(device),
+    mMaxAgeMs(maxAgeMs),
+    mFresh(false),
+    mStop(false),
+    mEnded(false),
+    mCaptured(0),
+    mRead(0),
+    mDropped(0)
+{
+    if(mCap.isOpened())
+        mThread = std::thread(&CameraCapture::run, this);
+    else
+        mEnded = true;
+}
+
+CameraCapture::~CameraCapture()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    if(mThread.joinable())
+        mThread.join();
+    mCap.release();
+}
+
+void CameraCapture::run()
+{
+    while(true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(mStop)
+                break;
+        }
+        // a new image each time, the reader may still hold the last one
+        cv::Mat img;
+        bool ok = mCap.read(img) && !img.empty();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(!ok)
+        {
+            mEnded = true;
+            mCond.notify_all();
+            break;
+        }
+        if(mFresh)
+            ++mDropped;
+        mFrame = img;
+        mFrameTime = std::chrono::steady_clock::now();
+        mFresh = true;
+        ++mCaptured;
+        mCond.notify_all();
+    }
+}
+
+bool CameraCapture::Read(cv::Mat &frame)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(true)
+    {
+        mCond.wait(lock, [this] { return mFresh || mEnded; });
+        if(!mFresh)
+            return false;
+        mFresh = false;
+
+        // skip ahead over a frame which got too old while the tracker was busy
+        if(mMaxAgeMs > 0 && std::chrono::steady_clock::now() - mFrameTime > std::chrono::milliseconds(mMaxAgeMs))
+        {
+            ++mDropped;
+            continue;
+        }
+        frame = mFrame;
+        ++mRead;
+        return true;
+    }
+}
+
+int CameraCapture::GetCaptured() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCaptured;
+}
+
+int CameraCapture::GetRead() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRead;
+}
+
+int CameraCapture::GetDropped() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDropped;
+}
@@ -26,20 +26,66 @@ Config::Config(const std::string& path)
         else if (name == "quietMode") iss >> mQuietMode;
         else if (name == "debugMode") iss >> mDebugMode;
         else if (name == "useCamera") iss >> mUseCamera;
+        else if (name == "cameraMaxAge") iss >> mCameraMaxAge;
         else if (name == "saveFrame") iss >> mSaveFrame;
         else if (name == "saveBoundingBox") iss >> mSaveBB;
         else if (name == "savePrecisionFile") iss >> mPrecision;
+        else if (name == "timeStages") iss >> mTimeStages;
         else if (name == "sequenceBasePath") iss >> mSeqBasePath;
+        else if (name == "inputFile") iss >> mInputFile;
+        else if (name == "rawWidth") iss >> mRawWidth;
+        else if (name == "rawHeight") iss >> mRawHeight;
+        else if (name == "decodeThreads") iss >> mDecodeThreads;
+        else if (name == "deinterlace") iss >> mDeinterlace;
+        else if (name == "targetsFile") iss >> mTargetsFile;
         else if (name == "svmC") iss >> mSvmC;
         else if (name == "svmBudgetSize") iss >> mSvmBudgetSize;
+        else if (name == "svmThreads") iss >> mSvmThreads;
+        else if (name == "asyncUpdate") iss >> mAsyncUpdate;
+        else if (name == "updateStaleness") iss >> mUpdateStaleness;
         else if (name == "patchNumX") iss >> mPatchNumX;
         else if (name == "patchNumY") iss >> mPatchNumY;
+        else if (name == "maxTargetArea") iss >> mMaxTargetArea;
+        else if (name == "searchStride") iss >> mSearchStride;
+        else if (name == "searchTopK") iss >> mSearchTopK;
+        else if (name == "denseSearch") iss >> mDenseSearch;
+        else if (name == "adaptiveRadius") iss >> mAdaptiveRadius;
+        else if (name == "boundedSearch") iss >> mBoundedSearch;
+        else if (name == "windowedImage") iss >> mWindowedImage;
+        else if (name == "subPixel") iss >> mSubPixel;
         else if (name == "seqName")
         {
             std::string sn;
             iss >> sn;
             mSeqNames.push_back(sn);
         }
+        else if (name == "input")
+        {
+            std::string inputName;
+            iss >> inputName;
+            if(inputName == InputName(kInputTypeImages)) mInputType = kInputTypeImages;
+            else if(inputName == InputName(kInputTypeVideo)) mInputType = kInputTypeVideo;
+            else if(inputName == InputName(kInputTypeRawBgr)) mInputType = kInputTypeRawBgr;
+            else if(inputName == InputName(kInputTypeRawYuv420)) mInputType = kInputTypeRawYuv420;
+            else if(inputName == InputName(kInputTypeCache)) mInputType = kInputTypeCache;
+            else
+            {
+                std::cout << "error: unrecognised input type: "<< inputName << std::endl;
+                continue;
+            }
+        }
+        else if (name == "svmBudgetType")
+        {
+            std::string budgetName;
+            iss >> budgetName;
+            if(budgetName == BudgetName(kBudgetTypeRemove)) mSvmBudgetType = kBudgetTypeRemove;
+            else if(budgetName == BudgetName(kBudgetTypeMerge)) mSvmBudgetType = kBudgetTypeMerge;
+            else
+            {
+                std::cout << "error: unrecognised budget type: "<< budgetName << std::endl;
+                continue;
+            }
+        }
         else if (name == "scaleType")
         {
             std::string scaleName;
@@ -96,6 +142,7 @@ Config::Config(const std::string& path)
 
     mBbFileName = FeatureName(mFeatureKernelPair.mFeature) + "_" + std::to_string(mPatchNumX) + "_" + std::to_string(mPatchNumY) + "_" + ScaleName(mScaleType) + "_bb.txt";
     mPrecFileName = FeatureName(mFeatureKernelPair.mFeature) + "_" + std::to_string(mPatchNumX) + "_" + std::to_string(mPatchNumY) + "_" + ScaleName(mScaleType) + "_prec.txt";
+    mTimesFileName = FeatureName(mFeatureKernelPair.mFeature) + "_" + std::to_string(mPatchNumX) + "_" + std::to_string(mPatchNumY) + "_" + ScaleName(mScaleType) + "_times.txt";
 
     if(mUseCamera)
     {
@@ -117,22 +164,44 @@ void Config::SetDefaults()
     mQuietMode = false;
     mDebugMode = false;
     mUseCamera = false;
+    mCameraMaxAge = 0;
 
     mSaveFrame = false;
     mSaveBB = false;
     mPrecision = false;
+    mTimeStages = false;
 
     mSeqBasePath = "sequences";
     mSeqName = "";
     mBbFileName = "_bb.txt";
     mPrecFileName = "_prec.txt";
+    mTimesFileName = "_times.txt";
+    mInputType = kInputTypeImages;
+    mInputFile = "";
+    mRawWidth = 0;
+    mRawHeight = 0;
+    mDecodeThreads = 0;
+    mDeinterlace = false;
+    mTargetsFile = "";
     mSeqNames.clear();
     mSeed = 0;
     mSvmC = 1.0;
     mSvmBudgetSize = 0;
+    mSvmBudgetType = kBudgetTypeRemove;
+    mSvmThreads = 1;
+    mAsyncUpdate = false;
+    mUpdateStaleness = 1;
     mPatchNumX = 1;
     mPatchNumY = 1;
     mSearchRadius = 0;
+    mMaxTargetArea = 0;
+    mSearchStride = 0;
+    mSearchTopK = 3;
+    mDenseSearch = false;
+    mAdaptiveRadius = false;
+    mBoundedSearch = false;
+    mWindowedImage = false;
+    mSubPixel = false;
     mFeatureKernelPair.mFeature = kFeatureTypeNone;
     mFeatureKernelPair.mKernel = kKernelTypeLinear;
     mScaleType = kScaleTypeAll;
@@ -193,16 +262,58 @@ std::string Config::ScaleName(ScaleType s)
     }
 }
 
+std::string Config::BudgetName(BudgetType b)
+{
+    switch (b) {
+    case kBudgetTypeRemove:
+        return "remove";
+    case kBudgetTypeMerge:
+        return "merge";
+    default:
+        return "";
+    }
+}
+
+std::string Config::InputName(InputType i)
+{
+    switch (i) {
+    case kInputTypeImages:
+        return "images";
+    case kInputTypeVideo:
+        return "video";
+    case kInputTypeRawBgr:
+        return "rawBgr";
+    case kInputTypeRawYuv420:
+        return "rawYuv420";
+    case kInputTypeCache:
+        return "cache";
+    default:
+        return "";
+    }
+}
+
 std::ostream& operator <<(std::ostream &out, const Config &conf)
 {
     out << "Config:"<<std::endl;
     out << "    quiteMode           = " << conf.mQuietMode << std::endl;
     out << "    debugMode           = " << conf.mDebugMode << std::endl;
     out << "    useCamera           = " << conf.mUseCamera << std::endl;
+    if(conf.mUseCamera)
+        out << "    cameraMaxAge        = " << conf.mCameraMaxAge << std::endl;
     out << "    saveFrame           = " << conf.mSaveFrame <<std::endl;
     out << "    saveBoundingBox     = " << conf.mSaveBB << std::endl;
     out << "    savePrecisionFile   = " << conf.mPrecision << std::endl;
+    out << "    timeStages          = " << conf.mTimeStages << std::endl;
     out << "    sequenceBasePath    = " << conf.mSeqBasePath << std::endl;
+    out << "    input               = " << Config::InputName(conf.mInputType) << std::endl;
+    if(conf.mInputType != Config::kInputTypeImages && conf.mInputType != Config::kInputTypeCache)
+        out << "    inputFile           = " << conf.mInputFile << std::endl;
+    if(conf.mInputType == Config::kInputTypeRawBgr || conf.mInputType == Config::kInputTypeRawYuv420)
+        out << "    rawSize             = " << conf.mRawWidth << "x" << conf.mRawHeight << std::endl;
+    out << "    decodeThreads       = " << conf.mDecodeThreads << std::endl;
+    out << "    deinterlace         = " << conf.mDeinterlace << std::endl;
+    if(!conf.mTargetsFile.empty())
+        out << "    targetsFile         = " << conf.mTargetsFile << std::endl;
     if(!conf.mUseCamera)
     {
         for (int i=0; i< (int) conf.mSeqNames.size(); ++i)
@@ -211,8 +322,20 @@ std::ostream& operator <<(std::ostream &out, const Config &conf)
     out << "    seed                = " << conf.mSeed << std::endl;
     out << "    patchNumX           = " << conf.mPatchNumX << std::endl;
     out << "    patchNumY           = " << conf.mPatchNumY << std::endl;
+    out << "    maxTargetArea       = " << conf.mMaxTargetArea << std::endl;
+    out << "    searchStride        = " << conf.mSearchStride << std::endl;
+    out << "    searchTopK          = " << conf.mSearchTopK << std::endl;
+    out << "    denseSearch         = " << conf.mDenseSearch << std::endl;
+    out << "    adaptiveRadius      = " << conf.mAdaptiveRadius << std::endl;
+    out << "    boundedSearch       = " << conf.mBoundedSearch << std::endl;
+    out << "    windowedImage       = " << conf.mWindowedImage << std::endl;
+    out << "    subPixel            = " << conf.mSubPixel << std::endl;
     out << "    svmC                = " << conf.mSvmC << std::endl;
     out << "    svmBudgetSize       = " << conf.mSvmBudgetSize << std::endl;
+    out << "    svmBudgetType       = " << Config::BudgetName(conf.mSvmBudgetType) << std::endl;
+    out << "    svmThreads          = " << conf.mSvmThreads << std::endl;
+    out << "    asyncUpdate         = " << conf.mAsyncUpdate << std::endl;
+    out << "    updateStaleness     = " << conf.mUpdateStaleness << std::endl;
     out << "    feature             = " << Config::FeatureName(conf.mFeatureKernelPair.mFeature) << std::endl;
     out << "    kernel              = " << Config::KernelName(conf.mFeatureKernelPair.mKernel) << std::endl;
     if(conf.mFeatureKernelPair.mParams.size() > 0)
@@ -226,4 +349,3 @@ std::ostream& operator <<(std::ostream &out, const Config &conf)
 
     return out;
 }
-
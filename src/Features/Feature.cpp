@@ -1,15 +1,18 @@
 #include "Features/Feature.h"
 #include "Sample.h"
+#include "StageTimer.h"
 
 
 Feature::Feature() :
-    mFeatureCount(0)
+    mFeatureCount(0),
+    mTimes(0)
 {
 
 }
 
 void Feature::Eval(const multiSample &samples, std::vector<Eigen::VectorXd> &featVecs)
 {
+    ScopedTimer timer(mTimes, kStageFeatureVectors);
     featVecs.resize(samples.getRects().size());
     for(int i=0; i<(int)featVecs.size(); ++i)
         featVecs[i] = Eval(samples.getSample(i));
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include "Features/GradFeature.h"
 #include "mUtils.h"
+#include "ImageRep.h"
 
 static const int kNumGrad = 16;
 static bool kUnsigned = false;
@@ -50,8 +51,22 @@ void GradFeature::compGrad(const cv::Mat &img, const IntRect &rect, cv::Mat &ori
     cv::Mat x_sobel, y_sobel;
     cv::Sobel(grayImg, x_sobel, CV_32FC1, 1, 0);
     cv::Sobel(grayImg, y_sobel, CV_32FC1, 0, 1);
+    compGradFromSobel(x_sobel, y_sobel, rect, orientation, mag);
+}
+
+void GradFeature::compGrad(const ImageRep &image, const IntRect &rect, cv::Mat &orientation, cv::Mat &mag) const
+{
+    if(image.HasGradients())
+        compGradFromSobel(image.GetGradX(), image.GetGradY(), rect, orientation, mag);
+    else
+        compGrad(image.GetGrayImage(), rect, orientation, mag);
+}
 
-    float *xp, *yp, *op;
+void GradFeature::compGradFromSobel(const cv::Mat &x_sobel, const cv::Mat &y_sobel, const IntRect &rect,
+                                    cv::Mat &orientation, cv::Mat &mag) const
+{
+    const float *xp, *yp;
+    float *op;
     double *mp;
     for(int iy=rect.YMin(); iy < rect.YMax(); ++iy)
     {
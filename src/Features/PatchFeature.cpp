@@ -1,10 +1,13 @@
+#include <algorithm>
+#include <cfloat>
 #include "Features/PatchFeature.h"
 #include "Sample.h"
 #include "mUtils.h"
+#include "Rng.h"
 
 void PatchFeature::Eval(const multiSample &samples, std::vector<Eigen::VectorXd> &featVecs)
 {
-    const_cast<PatchFeature*>(this)->PrepEval(samples);
+    Prepare(samples);
     Feature::Eval(samples, featVecs);
 }
 
@@ -56,7 +59,7 @@ cv::Mat PatchFeature::getPatchWeightFrame(const cv::Mat &frame, const FloatRect
 
 }
 
-void PatchFeature::extractPatchPts(const FloatRect &bb, const int ptNumPerPatch, std::vector<cv::Point2f> &pts)
+void PatchFeature::extractPatchPts(const FloatRect &bb, const int ptNumPerPatch, Rng &rng, std::vector<cv::Point2f> &pts)
 {
     setPatchRect(cv::Size(bb.Width(), bb.Height()));
     pts.clear();
@@ -70,8 +73,8 @@ void PatchFeature::extractPatchPts(const FloatRect &bb, const int ptNumPerPatch,
         // random extract points from each patch
         for(int p=0; p<ptNumPerPatch; ++p)
         {
-            float pt_x =RandomFloat(r.XMin(), r.XMax());
-            float pt_y =RandomFloat(r.YMin(), r.YMax());
+            float pt_x =rng.NextFloat(r.XMin(), r.XMax());
+            float pt_y =rng.NextFloat(r.YMin(), r.YMax());
             pts.push_back(cv::Point2f(pt_x, pt_y));
         }
     }
@@ -79,6 +82,226 @@ void PatchFeature::extractPatchPts(const FloatRect &bb, const int ptNumPerPatch,
 }
 
 
+// Linear kernel scores w.f(x) of all translations of centre within radius,
+// without building the feature vectors. The box sums of every bin are first
+// computed once per distinct patch size over the search window, then the
+// scores are accumulated as one shifted, weighted row pass per patch and bin.
+// scoreMap(radius+dy, radius+dx) is the score of centre translated by (dx, dy),
+// translations leaving the image get -DBL_MAX. The integral images must cover
+// the whole search window (see Prepare).
+void PatchFeature::EvalDenseLinear(const FloatRect &centre, int radius, const Eigen::VectorXd &w, cv::Mat &scoreMap)
+{
+    ScopedTimer timer(mTimes, kStageEvalSamples);
+    const IntRect rect = centre;
+    const int side = 2*radius+1;
+    scoreMap.create(side, side, CV_64FC1);
+    scoreMap.setTo(-DBL_MAX);
+
+    // range of valid sample origins
+    const int imgW = mIntegs[0].cols-1;
+    const int imgH = mIntegs[0].rows-1;
+    const int xa = std::max(rect.XMin()-radius, 0);
+    const int ya = std::max(rect.YMin()-radius, 0);
+    const int xb = std::min(rect.XMin()+radius, imgW-rect.Width());
+    const int yb = std::min(rect.YMin()+radius, imgH-rect.Height());
+    if(xa > xb || ya > yb)
+        return;
+    const int nx = xb-xa+1;
+    const int ny = yb-ya+1;
+
+    setPatchRect(cv::Size(rect.Width(), rect.Height()));
+    const int patchNum = mPatchNumX*mPatchNumY;
+
+    // box sum maps for each distinct patch size, one per bin
+    std::vector<cv::Size> sizes;
+    std::vector<int> sizeIdx(patchNum);
+    for(int pid=0; pid<patchNum; ++pid)
+    {
+        cv::Size s(mPatchRects[pid].Width(), mPatchRects[pid].Height());
+        int k = (int)(std::find(sizes.begin(), sizes.end(), s) - sizes.begin());
+        if(k == (int)sizes.size())
+            sizes.push_back(s);
+        sizeIdx[pid] = k;
+    }
+    std::vector<std::vector<cv::Mat> > boxSums(sizes.size(), std::vector<cv::Mat>(mBinNum));
+    for(int k=0; k<(int)sizes.size(); ++k)
+    {
+        const int mw = nx + rect.Width() - sizes[k].width;
+        const int mh = ny + rect.Height() - sizes[k].height;
+        for(int i=0; i<mBinNum; ++i)
+        {
+            cv::Mat& m = boxSums[k][i];
+            m.create(mh, mw, CV_32FC1);
+            for(int iy=0; iy<mh; ++iy)
+            {
+                const float* t = mIntegs[i].ptr<float>(ya+iy) + xa;
+                const float* b = mIntegs[i].ptr<float>(ya+iy+sizes[k].height) + xa;
+                Eigen::Map<Eigen::ArrayXf>(m.ptr<float>(iy), mw) =
+                        Eigen::Map<const Eigen::ArrayXf>(t, mw) + Eigen::Map<const Eigen::ArrayXf>(b+sizes[k].width, mw)
+                      - Eigen::Map<const Eigen::ArrayXf>(b, mw) - Eigen::Map<const Eigen::ArrayXf>(t+sizes[k].width, mw);
+            }
+        }
+    }
+
+    // accumulate w.f and |f|^2 of every bin group for all sample origins
+    Eigen::ArrayXXd score = Eigen::ArrayXXd::Zero(nx, ny);
+    Eigen::ArrayXXd dot(nx, ny);
+    Eigen::ArrayXXd sq(nx, ny);
+    Eigen::ArrayXd v(nx);
+    for(int g=0; g<(int)mBinGroups.size(); ++g)
+    {
+        const BinGroup& group = mBinGroups[g];
+        dot.setZero();
+        sq.setZero();
+        for(int pid=0; pid<patchNum; ++pid)
+        {
+            const IntRect& r = mPatchRects[pid];
+            double a = (float)mPatchWeights[pid] / r.Area();
+            for(int i=group.start; i<group.start+group.count; ++i)
+            {
+                double wi = w[mBinNum*pid + i];
+                const cv::Mat& m = boxSums[sizeIdx[pid]][i];
+                for(int iy=0; iy<ny; ++iy)
+                {
+                    v = a * Eigen::Map<const Eigen::ArrayXf>(m.ptr<float>(iy+r.YMin()) + r.XMin(), nx).cast<double>();
+                    dot.col(iy) += wi * v;
+                    sq.col(iy) += v.square();
+                }
+            }
+        }
+        score += group.weight * dot / (sq > 0).select(sq.sqrt(), 1.0);
+    }
+
+    for(int iy=0; iy<ny; ++iy)
+    {
+        double* sp = scoreMap.ptr<double>(ya+iy-rect.YMin()+radius) + xa-rect.XMin()+radius;
+        for(int ix=0; ix<nx; ++ix)
+            sp[ix] = score(ix, iy);
+    }
+}
+
+// Linear kernel scores w.f(x) of samples with early rejection. Patches are
+// visited in decreasing order of their weight norm. Per bin group, with a the
+// partial dot product, p the partial feature norm and b the norm of the
+// positive part of the remaining weights, the normalized group score is at
+// most sqrt((a/p)^2 + b^2) for a >= 0 and b otherwise, since features are
+// non-negative. A sample is abandoned as soon as this bound drops below the
+// best score so far, its score is then set to -DBL_MAX, so it is never the best.
+// Every exactStride-th sample is never abandoned, so that it always has its
+// score. Samples are visited by distance to the first one. Returns the number
+// of rejected samples.
+int PatchFeature::EvalBoundedLinear(const multiSample &samples, const Eigen::VectorXd &w, int exactStride, std::vector<double> &scores)
+{
+    Prepare(samples);
+    ScopedTimer timer(mTimes, kStageEvalSamples);
+    const std::vector<FloatRect>& rects = samples.getRects();
+    const int patchNum = mPatchNumX*mPatchNumY;
+    const int groupNum = (int)mBinGroups.size();
+    scores.assign(rects.size(), -DBL_MAX);
+    if(rects.empty())
+        return 0;
+
+    // patch order and remaining positive weight norms per group
+    std::vector<double> patchNorms(patchNum);
+    std::vector<int> patchOrder(patchNum);
+    for(int pid=0; pid<patchNum; ++pid)
+    {
+        patchNorms[pid] = w.segment(mBinNum*pid, mBinNum).squaredNorm();
+        patchOrder[pid] = pid;
+    }
+    std::sort(patchOrder.begin(), patchOrder.end(), [&patchNorms](int a, int b) { return patchNorms[a] > patchNorms[b]; });
+    Eigen::MatrixXd remaining = Eigen::MatrixXd::Zero(groupNum, patchNum+1);
+    for(int k=patchNum-1; k>=0; --k)
+    {
+        int pid = patchOrder[k];
+        for(int g=0; g<groupNum; ++g)
+        {
+            const BinGroup& group = mBinGroups[g];
+            remaining(g, k) = remaining(g, k+1) + w.segment(mBinNum*pid+group.start, group.count).cwiseMax(0.0).squaredNorm();
+        }
+    }
+    remaining = remaining.cwiseSqrt();
+
+    // visit the samples closest to the first one first
+    std::vector<int> sampleOrder(rects.size());
+    std::vector<float> dists(rects.size());
+    for(int i=0; i<(int)rects.size(); ++i)
+    {
+        float dx = rects[i].XMin() - rects[0].XMin();
+        float dy = rects[i].YMin() - rects[0].YMin();
+        dists[i] = dx*dx + dy*dy;
+        sampleOrder[i] = i;
+    }
+    std::stable_sort(sampleOrder.begin(), sampleOrder.end(), [&dists](int a, int b) { return dists[a] < dists[b]; });
+
+    double best = -DBL_MAX;
+    int rejected = 0;
+    std::vector<double> dot(groupNum);
+    std::vector<double> sq(groupNum);
+    for(int n=0; n<(int)sampleOrder.size(); ++n)
+    {
+        const int si = sampleOrder[n];
+        const IntRect rect = rects[si];
+        setPatchRect(cv::Size(rect.Width(), rect.Height()));
+        std::fill(dot.begin(), dot.end(), 0.0);
+        std::fill(sq.begin(), sq.end(), 0.0);
+        bool abandoned = false;
+        for(int k=0; k<patchNum && !abandoned; ++k)
+        {
+            const int pid = patchOrder[k];
+            IntRect r = mPatchRects[pid];
+            r.SetXMin(r.XMin() + rect.XMin());
+            r.SetYMin(r.YMin() + rect.YMin());
+            double a = (float)mPatchWeights[pid] / r.Area();
+            for(int g=0; g<groupNum; ++g)
+            {
+                const BinGroup& group = mBinGroups[g];
+                for(int i=group.start; i<group.start+group.count; ++i)
+                {
+                    double sum = mIntegs[i].at<float>(r.YMin(), r.XMin())
+                               + mIntegs[i].at<float>(r.YMax(), r.XMax())
+                               - mIntegs[i].at<float>(r.YMax(), r.XMin())
+                               - mIntegs[i].at<float>(r.YMin(), r.XMax());
+                    double v = a * sum;
+                    dot[g] += w[mBinNum*pid + i] * v;
+                    sq[g] += v * v;
+                }
+            }
+            if(k == patchNum-1 || best == -DBL_MAX || si % exactStride == 0)
+                continue;
+
+            double bound = 0.0;
+            for(int g=0; g<groupNum; ++g)
+            {
+                double b = remaining(g, k+1);
+                double gb = b;
+                if(dot[g] >= 0 && sq[g] > 0)
+                    gb = sqrt(dot[g]*dot[g]/sq[g] + b*b);
+                bound += mBinGroups[g].weight * gb;
+            }
+            if(bound < best)
+            {
+                scores[si] = -DBL_MAX;
+                abandoned = true;
+                ++rejected;
+            }
+        }
+        if(abandoned)
+            continue;
+
+        double score = 0.0;
+        for(int g=0; g<groupNum; ++g)
+        {
+            if(sq[g] > 0)
+                score += mBinGroups[g].weight * dot[g] / sqrt(sq[g]);
+        }
+        scores[si] = score;
+        best = std::max(best, score);
+    }
+
+    return rejected;
+}
+
 void PatchFeature::setPatchRect(const cv::Size &sample_size)
 {
     if(mSampleSize == sample_size)
@@ -17,6 +17,8 @@ PatchGradFeature::PatchGradFeature(const Config &conf) :
 
     mPatchWeights = Eigen::VectorXd::Ones(mPatchNumX*mPatchNumY);
 
+    mBinGroups.push_back(BinGroup(0, mBinNum, 1.0));
+
 #if VERBOSE
     std::cout<<"Patch grad histogram bins: "<< GetCount() << std::endl;
 #endif
@@ -49,7 +51,7 @@ void PatchGradFeature::PrepEval(const multiSample &samples)
     // todo: compute gradient map
     cv::Mat oriImg = cv::Mat::zeros(imgH, imgW, CV_32FC1);
     cv::Mat magImg = cv::Mat::zeros(imgH, imgW, CV_64FC1);
-    mGradFeature.compGrad(imgGray, unionRect, oriImg, magImg);
+    mGradFeature.compGrad(samples.getImage(), unionRect, oriImg, magImg);
 
     float *op;
     for(int iy=unionRect.YMin(); iy<unionRect.YMax(); ++iy)
@@ -129,7 +131,7 @@ void PatchGradFeature::UpdateWeightModel(const Sample &s)
 
     cv::Mat oriImg = cv::Mat::zeros(imgH, imgW, CV_32FC1);
     cv::Mat magImg = cv::Mat::zeros(imgH, imgW, CV_64FC1);
-    mGradFeature.compGrad(grayImg, rect, oriImg, magImg);
+    mGradFeature.compGrad(s.getImage(), rect, oriImg, magImg);
     mWeightInteg = cv::Mat::zeros(imgH+1, imgW+1, CV_64FC1);
     cv::integral(magImg, mWeightInteg, CV_64F);
 
@@ -17,6 +17,8 @@ PatchGrayFeature::PatchGrayFeature(const Config &conf) :
 
     mPatchWeights = Eigen::VectorXd::Ones(mPatchNumX*mPatchNumY);
 
+    mBinGroups.push_back(BinGroup(0, mBinNum, 1.0));
+
 #if VERBOSE
     std::cout<<"Patch gray histogram bins: "<< GetCount() << std::endl;
 #endif
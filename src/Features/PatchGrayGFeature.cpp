@@ -22,6 +22,10 @@ PatchGrayGFeature::PatchGrayGFeature(const Config &conf) :
     mGrayWeight = 0.5;
     mGradWeight = 1-mGrayWeight;
 
+    float weight_norm = sqrt(mGrayWeight*mGrayWeight + mGradWeight*mGradWeight);
+    mBinGroups.push_back(BinGroup(0, mGrayBinNum, mGrayWeight/weight_norm));
+    mBinGroups.push_back(BinGroup(mGrayBinNum, mGradBinNum, mGradWeight/weight_norm));
+
 #if VERBOSE
     std::cout<<"Patch gray grad histogram bins: "<< GetCount() << std::endl;
 #endif
@@ -92,7 +96,7 @@ void PatchGrayGFeature::PrepEval(const multiSample &samples)
     // todo: compute gradient map
     cv::Mat oriImg = cv::Mat::zeros(imgH, imgW, CV_32FC1);
     cv::Mat magImg = cv::Mat::zeros(imgH, imgW, CV_64FC1);
-    mGradFeature.compGrad(imgGray, unionRect, oriImg, magImg);
+    mGradFeature.compGrad(samples.getImage(), unionRect, oriImg, magImg);
 
     float *op;
     for(int iy=unionRect.YMin(); iy<unionRect.YMax(); ++iy)
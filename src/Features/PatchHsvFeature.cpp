@@ -18,6 +18,8 @@ PatchHsvFeature::PatchHsvFeature(const Config &conf) :
 
     mPatchWeights = Eigen::VectorXd::Ones(mPatchNumX*mPatchNumY);
 
+    mBinGroups.push_back(BinGroup(0, mBinNum, 1.0));
+
 #if VERBOSE
     std::cout<<"Patch hsv histogram bins: "<< GetCount() << std::endl;
 #endif
@@ -25,6 +25,10 @@ PatchHsvGFeature::PatchHsvGFeature(const Config &conf) :
     mColorWeight = 0.5;
     mGradWeight = 1-mColorWeight;
 
+    float weight_norm = sqrt(mColorWeight*mColorWeight + mGradWeight*mGradWeight);
+    mBinGroups.push_back(BinGroup(0, mHsvBinNum, mColorWeight/weight_norm));
+    mBinGroups.push_back(BinGroup(mHsvBinNum, mGradBinNum, mGradWeight/weight_norm));
+
 #if VERBOSE
     std::cout<<"Patch hsv grad histogram bins: "<< GetCount() << std::endl;
 #endif
@@ -108,7 +112,7 @@ void PatchHsvGFeature::PrepEval(const multiSample &samples)
     // todo: compute gradient map
     cv::Mat oriImg = cv::Mat::zeros(imgH, imgW, CV_32FC1);
     cv::Mat magImg = cv::Mat::zeros(imgH, imgW, CV_64FC1);
-    mGradFeature.compGrad(samples.getImage().GetGrayImage(), unionRect, oriImg, magImg);
+    mGradFeature.compGrad(samples.getImage(), unionRect, oriImg, magImg);
 
     float *op;
     for(int iy=unionRect.YMin(); iy<unionRect.YMax(); ++iy)
@@ -23,6 +23,10 @@ PatchRgbGFeature::PatchRgbGFeature(const Config &conf) :
     mColorWeight = 0.5;
     mGradWeight = 1-mColorWeight;
 
+    float weight_norm = sqrt(mColorWeight*mColorWeight + mGradWeight*mGradWeight);
+    mBinGroups.push_back(BinGroup(0, mRgbBinNum, mColorWeight/weight_norm));
+    mBinGroups.push_back(BinGroup(mRgbBinNum, mGradBinNum, mGradWeight/weight_norm));
+
 #if VERBOSE
     std::cout<<"Patch rgb grad histogram bins: "<< GetCount() << std::endl;
 #endif
@@ -103,7 +107,7 @@ void PatchRgbGFeature::PrepEval(const multiSample &samples)
     // todo: compute gradient map
     cv::Mat oriImg = cv::Mat::zeros(imgH, imgW, CV_32FC1);
     cv::Mat magImg = cv::Mat::zeros(imgH, imgW, CV_64FC1);
-    mGradFeature.compGrad(samples.getImage().GetGrayImage(), unionRect, oriImg, magImg);
+    mGradFeature.compGrad(samples.getImage(), unionRect, oriImg, magImg);
 
     float *op;
     for(int iy=unionRect.YMin(); iy<unionRect.YMax(); ++iy)
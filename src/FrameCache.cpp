@@ -0,0 +1,124 @@
+#include <cstring>
+#include <iostream>
+#include "FrameCache.h"
+#include "Config.h"
+
+static const char kMagic[8] = {'P', 'A', 'W', 'S', 'S', 'F', 'C', '\0'};
+static const int kVersion = 1;
+
+FrameCacheWriter::FrameCacheWriter(const std::string &path, int startFrame, float scaleW, float scaleH) :
+    mFile(path.c_str(), std::ios::out | std::ios::binary)
+{
+    memset(&mHeader, 0, sizeof(mHeader));
+    memcpy(mHeader.mMagic, kMagic, sizeof(kMagic));
+    mHeader.mVersion = kVersion;
+    mHeader.mStartFrame = startFrame;
+    mHeader.mScaleW = scaleW;
+    mHeader.mScaleH = scaleH;
+    // the header is written again by Close, with the size of the frames and their number
+    if(mFile.is_open())
+        mFile.write((const char*)&mHeader, sizeof(mHeader));
+}
+
+FrameCacheWriter::~FrameCacheWriter()
+{
+    if(mFile.is_open())
+        Close();
+}
+
+bool FrameCacheWriter::Write(const cv::Mat &frame)
+{
+    if(mHeader.mFrameNum == 0)
+    {
+        mHeader.mWidth = frame.cols;
+        mHeader.mHeight = frame.rows;
+        mHeader.mType = frame.type();
+    }
+    else if(frame.cols != mHeader.mWidth || frame.rows != mHeader.mHeight || frame.type() != mHeader.mType)
+    {
+        std::cout << "error: frame " << mHeader.mStartFrame + mHeader.mFrameNum << " differs in size from the first frame" << std::endl;
+        return false;
+    }
+
+    const size_t rowBytes = frame.cols * frame.elemSize();
+    for(int y=0; y<frame.rows; ++y)
+        mFile.write((const char*)frame.ptr(y), rowBytes);
+    ++mHeader.mFrameNum;
+    return mFile.good();
+}
+
+bool FrameCacheWriter::Close()
+{
+    mFile.seekp(0);
+    mFile.write((const char*)&mHeader, sizeof(mHeader));
+    bool ok = mFile.good();
+    mFile.close();
+    return ok;
+}
+
+FrameCacheSource::FrameCacheSource(const std::string &path) :
+    mData(0),
+    mFrameBytes(0)
+{
+    memset(&mHeader, 0, sizeof(mHeader));
+    try
+    {
+        mFileMapping.reset(new boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only));
+        mRegion.reset(new boost::interprocess::mapped_region(*mFileMapping, boost::interprocess::read_only));
+    }
+    catch(const boost::interprocess::interprocess_exception& e)
+    {
+        std::cout << "error: could not map frame cache: " << path << " (" << e.what() << ")" << std::endl;
+        return;
+    }
+
+    const unsigned char* base = (const unsigned char*)mRegion->get_address();
+    if(mRegion->get_size() < sizeof(mHeader))
+    {
+        std::cout << "error: frame cache too short: " << path << std::endl;
+        return;
+    }
+    memcpy(&mHeader, base, sizeof(mHeader));
+    if(!checkHeader(mRegion->get_size() - sizeof(mHeader)))
+    {
+        std::cout << "error: invalid frame cache: " << path << std::endl;
+        return;
+    }
+    mData = base + sizeof(mHeader);
+}
+
+// the header describes valid frames which all lie in the dataBytes behind it,
+// sizes are checked by division so that a corrupt header cannot overflow them
+bool FrameCacheSource::checkHeader(size_t dataBytes)
+{
+    if(memcmp(mHeader.mMagic, kMagic, sizeof(kMagic)) != 0 || mHeader.mVersion != kVersion)
+        return false;
+    const int type = mHeader.mType;
+    if(type < 0 || type != (type & CV_MAT_TYPE_MASK) || CV_MAT_DEPTH(type) > CV_64F)
+        return false;
+    if(mHeader.mWidth <= 0 || mHeader.mHeight <= 0 || mHeader.mFrameNum < 0)
+        return false;
+
+    const size_t elemBytes = CV_ELEM_SIZE(type);
+    if((size_t)mHeader.mWidth > dataBytes / elemBytes / mHeader.mHeight)
+        return false;
+    mFrameBytes = (size_t)mHeader.mWidth * mHeader.mHeight * elemBytes;
+    return (size_t)mHeader.mFrameNum <= dataBytes / mFrameBytes;
+}
+
+bool FrameCacheSource::Read(int frameInd, cv::Mat &frame)
+{
+    int i = frameInd - mHeader.mStartFrame;
+    if(!mData || i < 0 || i >= mHeader.mFrameNum)
+    {
+        frame.release();
+        return false;
+    }
+    frame = cv::Mat(mHeader.mHeight, mHeader.mWidth, mHeader.mType, (void*)(mData + i * mFrameBytes));
+    return true;
+}
+
+std::string FrameCacheSource::GetPath(const Config &conf)
+{
+    return conf.mSeqBasePath + "/" + conf.mSeqName + "/" + conf.mSeqName + "_cache.bin";
+}
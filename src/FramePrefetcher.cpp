@@ -0,0 +1,79 @@
+#include "FramePrefetcher.h"
+#include "FrameSource.h"
+#include "mUtils.h"
+
+FramePrefetcher::FramePrefetcher(FrameSource &source, int startFrame, int endFrame,
+                                 float scaleW, float scaleH, bool deinterlace, int interpolation, int workerNum) :
+    mSource(source),
+    mEndFrame(endFrame),
+    mScaleW(scaleW),
+    mScaleH(scaleH),
+    mDeinterlace(deinterlace),
+    mInterpolation(interpolation),
+    mSlots(2*std::max(workerNum, 1) + 2),
+    mNextRead(startFrame),
+    mNextDecode(startFrame),
+    mStop(false)
+{
+    for(int i=0; i<(int)mSlots.size(); ++i)
+        mSlots[i].ready = false;
+    if(!source.IsRandomAccess())
+        workerNum = 1;
+    for(int i=0; i<std::max(workerNum, 1); ++i)
+        mWorkers.push_back(std::thread(&FramePrefetcher::run, this));
+}
+
+FramePrefetcher::~FramePrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCond.notify_all();
+    for(int i=0; i<(int)mWorkers.size(); ++i)
+        mWorkers[i].join();
+}
+
+bool FramePrefetcher::Next(cv::Mat &frameOrig, cv::Mat &frame)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if(mNextRead > mEndFrame)
+        return false;
+    Slot& slot = mSlots[mNextRead % mSlots.size()];
+    mCond.wait(lock, [&slot] { return slot.ready; });
+    frameOrig = slot.orig;
+    frame = slot.scaled;
+    slot.orig.release();
+    slot.scaled.release();
+    slot.ready = false;
+    ++mNextRead;
+    mCond.notify_all();
+    return true;
+}
+
+void FramePrefetcher::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(true)
+    {
+        mCond.wait(lock, [this] { return mStop || mNextDecode > mEndFrame || mNextDecode < mNextRead + (int)mSlots.size(); });
+        if(mStop || mNextDecode > mEndFrame)
+            return;
+        int frameInd = mNextDecode++;
+        lock.unlock();
+
+        cv::Mat orig, scaled;
+        if(mSource.Read(frameInd, orig))
+            prepareFrame(orig, mScaleW, mScaleH, mDeinterlace, mInterpolation, scaled);
+
+        lock.lock();
+        // a sequential source ends at its first missing frame
+        if(orig.empty() && !mSource.IsRandomAccess())
+            mEndFrame = std::min(mEndFrame, frameInd);
+        Slot& slot = mSlots[frameInd % mSlots.size()];
+        slot.orig = orig;
+        slot.scaled = scaled;
+        slot.ready = true;
+        mCond.notify_all();
+    }
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <vector>
+#include "FrameSource.h"
+#include "Config.h"
+#include "FrameCache.h"
+
+FrameSource* FrameSource::Create(const Config &conf, int firstFrame)
+{
+    const std::string seqPath = conf.mSeqBasePath + "/" + conf.mSeqName + "/";
+    std::string filePath = conf.mInputFile;
+    if(!filePath.empty() && filePath != "-" && filePath[0] != '/')
+        filePath = seqPath + filePath;
+
+    switch(conf.mInputType)
+    {
+    case Config::kInputTypeImages:
+        return new ImageFileSource(seqPath + "img/%04d.jpg");
+    case Config::kInputTypeVideo:
+    {
+        VideoFileSource* source = new VideoFileSource(filePath, firstFrame);
+        if(source->IsOpened())
+            return source;
+        delete source;
+        break;
+    }
+    case Config::kInputTypeRawBgr:
+    case Config::kInputTypeRawYuv420:
+    {
+        RawStreamSource* source = new RawStreamSource(filePath, conf.mRawWidth, conf.mRawHeight,
+                                                      conf.mInputType == Config::kInputTypeRawYuv420, firstFrame);
+        if(source->IsOpened())
+            return source;
+        delete source;
+        break;
+    }
+    case Config::kInputTypeCache:
+    {
+        filePath = FrameCacheSource::GetPath(conf);
+        FrameCacheSource* source = new FrameCacheSource(filePath);
+        if(source->IsOpened())
+            return source;
+        delete source;
+        break;
+    }
+    default:
+        break;
+    }
+    std::cout << "error: could not open input: " << filePath << std::endl;
+    return 0;
+}
+
+std::string ImageFileSource::GetPath(int frameInd) const
+{
+    std::vector<char> path(mFormat.size() + 32);
+    snprintf(&path[0], path.size(), mFormat.c_str(), frameInd);
+    return std::string(&path[0]);
+}
+
+bool ImageFileSource::Read(int frameInd, cv::Mat &frame)
+{
+    frame = cv::imread(GetPath(frameInd), cv::IMREAD_COLOR);
+    return !frame.empty();
+}
+
+VideoFileSource::VideoFileSource(const std::string &path, int firstFrame) :
+    mCap(path),
+    mNextFrame(firstFrame)
+{
+}
+
+bool VideoFileSource::Read(int frameInd, cv::Mat &frame)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for(; mNextFrame < frameInd; ++mNextFrame)
+    {
+        if(!mCap.grab())
+            return false;
+    }
+    if(mNextFrame > frameInd || !mCap.read(frame))
+        return false;
+    ++mNextFrame;
+    return !frame.empty();
+}
+
+RawStreamSource::RawStreamSource(const std::string &path, int width, int height, bool yuv, int firstFrame) :
+    mFile(0),
+    mWidth(width),
+    mHeight(height),
+    mYuv(yuv),
+    mNextFrame(firstFrame)
+{
+    if(width <= 0 || height <= 0 || (yuv && (width % 2 || height % 2)))
+    {
+        std::cout << "error: invalid raw frame size " << width << "x" << height << std::endl;
+        return;
+    }
+    mFile = path == "-" ? stdin : fopen(path.c_str(), "rb");
+    if(yuv)
+        mBuffer = cv::Mat(height*3/2, width, CV_8UC1);
+    else
+        mBuffer = cv::Mat(height, width, CV_8UC3);
+}
+
+RawStreamSource::~RawStreamSource()
+{
+    if(mFile && mFile != stdin)
+        fclose(mFile);
+}
+
+bool RawStreamSource::Read(int frameInd, cv::Mat &frame)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(!mFile || mNextFrame > frameInd)
+        return false;
+    const size_t frameBytes = mBuffer.total() * mBuffer.elemSize();
+    for(; mNextFrame <= frameInd; ++mNextFrame)
+    {
+        // pipes cannot seek, read the skipped frames too
+        if(fread(mBuffer.data, 1, frameBytes, mFile) != frameBytes)
+            return false;
+    }
+    if(mYuv)
+        cv::cvtColor(mBuffer, frame, cv::COLOR_YUV2BGR_I420);
+    else
+        frame = mBuffer.clone();
+    return true;
+}
@@ -0,0 +1,109 @@
+#include "FrameTracker.h"
+#include "mUtils.h"
+#include "Tracker.h"
+
+static const float kCameraScale = 0.3;
+
+FrameTracker::FrameTracker(const Config &conf) :
+    mConfig(conf),
+    mInitialised(false),
+    mScaleW(1.f),
+    mScaleH(1.f)
+{
+}
+
+FrameTracker::~FrameTracker()
+{
+}
+
+void FrameTracker::GetFrameScale(const Config &conf, const FloatRect &bb, float &scaleW, float &scaleH)
+{
+    // camera frames have a fixed scale unless the target area is limited
+    if(conf.mUseCamera && conf.mMaxTargetArea <= 0)
+    {
+        scaleW = kCameraScale;
+        scaleH = kCameraScale;
+    }
+    else
+    {
+        scaleFrame(bb.Width(), bb.Height(), scaleW, scaleH, conf.mMaxTargetArea);
+    }
+}
+
+// frames shrunk for maxTargetArea are averaged, all others (upsampled, or
+// the fixed camera scale) are interpolated linearly as they always were
+int FrameTracker::GetFrameInterpolation(const Config &conf, float scaleW, float scaleH)
+{
+    return (conf.mMaxTargetArea > 0 && scaleW < 1 && scaleH < 1) ? cv::INTER_AREA : cv::INTER_LINEAR;
+}
+
+void FrameTracker::Initialise(const cv::Mat &frame, const FloatRect &bb)
+{
+    // the scale of the frames follows from the target
+    GetFrameScale(mConfig, bb, mScaleW, mScaleH);
+    PrepareFrame(frame, mFrame);
+    initialise(bb);
+}
+
+void FrameTracker::InitialisePrepared(const cv::Mat &frame, const FloatRect &bb)
+{
+    GetFrameScale(mConfig, bb, mScaleW, mScaleH);
+    mFrame = frame;
+    initialise(bb);
+}
+
+// start tracking bb in mFrame
+void FrameTracker::initialise(const FloatRect &bb)
+{
+    FloatRect initBB(bb.XMin()*mScaleW, bb.YMin()*mScaleH, bb.Width()*mScaleW, bb.Height()*mScaleH);
+    mConfig.mSearchRadius = std::round((initBB.Width()+initBB.Height())/2);
+
+    // the tracker keeps a reference to the config, so it is recreated with the search radius
+    mTracker.reset(new Tracker(mConfig));
+    mTracker->Initialise(mFrame, initBB);
+    // the first frame is tracked too, its result is the given box
+    mTracker->Track(mFrame);
+    mBb = bb;
+    mInitialised = true;
+}
+
+void FrameTracker::Initialise(const unsigned char *data, int width, int height, int stride, const FloatRect &bb)
+{
+    const cv::Mat frame(height, width, CV_8UC3, const_cast<unsigned char*>(data), stride);
+    Initialise(frame, bb);
+}
+
+const FloatRect& FrameTracker::Track(const cv::Mat &frame)
+{
+    cv::Mat scaled;
+    PrepareFrame(frame, scaled);
+    return TrackPrepared(scaled);
+}
+
+const FloatRect& FrameTracker::Track(const unsigned char *data, int width, int height, int stride)
+{
+    const cv::Mat frame(height, width, CV_8UC3, const_cast<unsigned char*>(data), stride);
+    return Track(frame);
+}
+
+const FloatRect& FrameTracker::TrackPrepared(const cv::Mat &frame)
+{
+    assert(mInitialised);
+    mFrame = frame;
+    mTracker->Track(mFrame);
+    const FloatRect& bb = mTracker->getBB();
+    mBb = FloatRect(bb.XMin()/mScaleW, bb.YMin()/mScaleH, bb.Width()/mScaleW, bb.Height()/mScaleH);
+    return mBb;
+}
+
+void FrameTracker::PrepareFrame(const cv::Mat &frameOrig, cv::Mat &frame) const
+{
+    prepareFrame(frameOrig, mScaleW, mScaleH, mConfig.mDeinterlace, GetInterpolation(), frame);
+}
+
+void FrameTracker::Reset()
+{
+    if(mTracker)
+        mTracker->Reset();
+    mInitialised = false;
+}
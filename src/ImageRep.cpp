@@ -1,8 +1,9 @@
 #include "ImageRep.h"
 
-ImageRep::ImageRep(const cv::Mat &image, bool hsv_flag, bool color) :
+ImageRep::ImageRep(const cv::Mat &image, bool hsv_flag, bool color, bool grad) :
     mRect(0, 0, image.cols, image.rows),
-    mChannels(color ? 3:1)
+    mChannels(color ? 3:1),
+    mOrigin(0, 0)
 {
     mBaseImg = image;
     if(color)
@@ -34,5 +35,35 @@ ImageRep::ImageRep(const cv::Mat &image, bool hsv_flag, bool color) :
         else {
             mGrayImg = image; }
     }
+
+    if(grad)
+    {
+        cv::Sobel(mGrayImg, mGradX, CV_32FC1, 1, 0);
+        cv::Sobel(mGrayImg, mGradY, CV_32FC1, 0, 1);
+    }
+}
+
+ImageRep::ImageRep(const cv::Mat &frame, const IntRect &window, bool hsv_flag, bool color, bool grad) :
+    ImageRep(frame(cv::Rect(window.XMin(), window.YMin(), window.Width(), window.Height())), hsv_flag, color, grad)
+{
+    mOrigin = cv::Point(window.XMin(), window.YMin());
 }
 
+ImageRep::ImageRep(const ImageRep &image, const IntRect &window) :
+    mChannels(image.mChannels),
+    mRect(0, 0, window.Width(), window.Height()),
+    mOrigin(image.mOrigin.x + window.XMin(), image.mOrigin.y + window.YMin())
+{
+    cv::Rect roi(window.XMin(), window.YMin(), window.Width(), window.Height());
+    mBaseImg = image.mBaseImg(roi);
+    mGrayImg = image.mGrayImg(roi);
+    if(!image.mColorImg.empty())
+        mColorImg = image.mColorImg(roi);
+    for(int i=0; i<(int)image.mImgs.size(); ++i)
+        mImgs.push_back(image.mImgs[i](roi));
+    if(image.HasGradients())
+    {
+        mGradX = image.mGradX(roi);
+        mGradY = image.mGradY(roi);
+    }
+}
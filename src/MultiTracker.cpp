@@ -0,0 +1,129 @@
+#include <chrono>
+#include "MultiTracker.h"
+#include "FrameTracker.h"
+#include "ImageRep.h"
+#include "mUtils.h"
+#include "StageTimer.h"
+#include "Tracker.h"
+#include "WorkerPool.h"
+
+MultiTracker::MultiTracker(const Config &conf) :
+    mConfig(conf),
+    mInitialised(false),
+    mScaleW(1.f),
+    mScaleH(1.f)
+{
+}
+
+MultiTracker::~MultiTracker()
+{
+}
+
+void MultiTracker::Initialise(const cv::Mat &frame, const std::vector<FloatRect> &bbs)
+{
+    assert(!bbs.empty());
+
+    // the frames are scaled for the target which needs the largest scale
+    mScaleW = 0.f;
+    mScaleH = 0.f;
+    for(int i=0; i<(int)bbs.size(); ++i)
+    {
+        float scaleW, scaleH;
+        FrameTracker::GetFrameScale(mConfig, bbs[i], scaleW, scaleH);
+        mScaleW = std::max(mScaleW, scaleW);
+        mScaleH = std::max(mScaleH, scaleH);
+    }
+
+    mConfigs.clear();
+    mTrackers.clear();
+    std::vector<FloatRect> initBBs;
+    for(int i=0; i<(int)bbs.size(); ++i)
+    {
+        FloatRect initBB(bbs[i].XMin()*mScaleW, bbs[i].YMin()*mScaleH, bbs[i].Width()*mScaleW, bbs[i].Height()*mScaleH);
+        mConfigs.push_back(std::unique_ptr<Config>(new Config(mConfig)));
+        mConfigs.back()->mSearchRadius = std::round((initBB.Width()+initBB.Height())/2);
+        mTrackers.push_back(std::unique_ptr<Tracker>(new Tracker(*mConfigs.back())));
+        initBBs.push_back(initBB);
+    }
+    if(!mPool || mPool->GetWorkerNum() != (int)mTrackers.size()-1)
+        mPool.reset(new WorkerPool(mTrackers.size()-1));
+
+    PrepareFrame(frame, mFrame);
+    const Tracker& first = *mTrackers[0];
+    ImageRep image(mFrame, first.needHsv(), first.needColor(), first.needGrad());
+
+    // the first frame is tracked too, its results are the given boxes
+    mPool->Run(mTrackers.size(), [this, &image, &initBBs](int i) {
+        mTrackers[i]->Initialise(image, initBBs[i]);
+        mTrackers[i]->Track(image);
+    });
+
+    mBBs = bbs;
+    mInitialised = true;
+}
+
+const std::vector<FloatRect>& MultiTracker::Track(const cv::Mat &frame)
+{
+    cv::Mat scaled;
+    PrepareFrame(frame, scaled);
+    return TrackPrepared(scaled);
+}
+
+const std::vector<FloatRect>& MultiTracker::TrackPrepared(const cv::Mat &frame)
+{
+    assert(mInitialised);
+    mFrame = frame;
+
+    // one representation of the part of the frame any of the targets reads
+    IntRect window = mTrackers[0]->GetSearchWindow();
+    int x0 = window.XMin(), y0 = window.YMin(), x1 = window.XMax(), y1 = window.YMax();
+    for(int i=1; i<(int)mTrackers.size(); ++i)
+    {
+        window = mTrackers[i]->GetSearchWindow();
+        x0 = std::min(x0, window.XMin());
+        y0 = std::min(y0, window.YMin());
+        x1 = std::max(x1, window.XMax());
+        y1 = std::max(y1, window.YMax());
+    }
+    const Tracker& first = *mTrackers[0];
+    std::chrono::steady_clock::time_point imageStart = std::chrono::steady_clock::now();
+    ImageRep image(frame, IntRect(x0, y0, x1-x0, y1-y0), first.needHsv(), first.needColor(), first.needGrad());
+    addImageRepTime(imageStart);
+
+    // every target on its own worker, the first one on this thread
+    mPool->Run(mTrackers.size(), [this, &image](int i) { mTrackers[i]->Track(image); });
+
+    for(int i=0; i<(int)mTrackers.size(); ++i)
+    {
+        const FloatRect& bb = mTrackers[i]->getBB();
+        mBBs[i] = FloatRect(bb.XMin()/mScaleW, bb.YMin()/mScaleH, bb.Width()/mScaleW, bb.Height()/mScaleH);
+    }
+    return mBBs;
+}
+
+// the shared representation is the ImageRep stage of every target
+void MultiTracker::addImageRepTime(std::chrono::steady_clock::time_point start)
+{
+    if(!mConfig.mTimeStages)
+        return;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for(int i=0; i<(int)mTrackers.size(); ++i)
+        mTrackers[i]->getStageTimer()->Add(kStageImageRep, ms);
+}
+
+int MultiTracker::GetInterpolation() const
+{
+    return FrameTracker::GetFrameInterpolation(mConfig, mScaleW, mScaleH);
+}
+
+void MultiTracker::PrepareFrame(const cv::Mat &frameOrig, cv::Mat &frame) const
+{
+    prepareFrame(frameOrig, mScaleW, mScaleH, mConfig.mDeinterlace, GetInterpolation(), frame);
+}
+
+void MultiTracker::Reset()
+{
+    for(int i=0; i<(int)mTrackers.size(); ++i)
+        mTrackers[i]->Reset();
+    mInitialised = false;
+}
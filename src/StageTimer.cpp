@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "StageTimer.h"
+
+void StageTimes::Add(Stage stage, double ms)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTimes[stage].push_back(ms);
+}
+
+void StageTimes::Clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for(int i=0; i<kStageNum; ++i)
+        mTimes[i].clear();
+}
+
+bool StageTimes::Write(const std::string &filePath) const
+{
+    std::ofstream timesFile(filePath.c_str());
+    if(!timesFile.is_open())
+    {
+        std::cout << "error: could not open stage times file: " << filePath << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    timesFile << "# stage count mean p50 p95 p99 max (ms)" << std::endl;
+    timesFile << std::fixed << std::setprecision(4);
+    for(int i=0; i<kStageNum; ++i)
+    {
+        std::vector<double> times(mTimes[i]);
+        if(times.empty())
+            continue;
+        std::sort(times.begin(), times.end());
+        double sum = 0.0;
+        for(int j=0; j<(int)times.size(); ++j)
+            sum += times[j];
+        auto percentile = [&times](double p) { return times[std::min(times.size()-1, (size_t)(p * times.size()))]; };
+        timesFile << StageName((Stage)i) << " " << times.size() << " " << sum / times.size() << " "
+                  << percentile(0.5) << " " << percentile(0.95) << " " << percentile(0.99) << " " << times.back() << std::endl;
+    }
+    return true;
+}
+
+std::string StageTimes::StageName(Stage stage)
+{
+    switch (stage) {
+    case kStageImageRep:
+        return "imageRep";
+    case kStagePrepEval:
+        return "prepEval";
+    case kStageFeatureVectors:
+        return "featureVectors";
+    case kStageEvalSamples:
+        return "evalSamples";
+    case kStageScaleEstimate:
+        return "scaleEstimate";
+    case kStageSvmProcessNew:
+        return "svmProcessNew";
+    case kStageSvmReprocess:
+        return "svmReprocess";
+    case kStageSvmBudget:
+        return "svmBudgetMaintenance";
+    case kStageWeightModel:
+        return "weightModel";
+    default:
+        return "";
+    }
+}
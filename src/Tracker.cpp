@@ -1,3 +1,5 @@
+#include <map>
+#include <set>
 #include "Tracker.h"
 #include "mUtils.h"
 #include "Sample.h"
@@ -14,26 +16,45 @@
 #include "Features/PatchRgbFeature.h"
 #include "Features/PatchRgbGFeature.h"
 #include "scaleEstimator.h"
+#include "StageTimer.h"
+#include "WorkerPool.h"
 
 static const int kGradualScaleNum = 9;
 static const int kAbruptScaleNum = 11;
 static const float kScaleBase = 1.003;
 static const double kUpdateSimilarity = 0.3;
+static const int kScaleSearchRadius = 5;
+static const float kWindowScale = 1.5;      // largest scale change the search window allows for
+
+// adaptive search radius
+static const float kVelocityRate = 0.5;     // smoothing of the velocity estimate
+static const float kInnovationRate = 0.3;   // smoothing of the prediction error
+static const float kRadiusGain = 3.0;       // search radius in units of the prediction error
+static const float kMinRadiusRatio = 0.25;  // lower bound relative to the configured radius
+static const float kEdgeRatio = 0.7;        // best sample this far out means the target may be further
+static const double kMinSharpness = 2.0;    // best score in standard deviations above the mean score
+static const int kSharpnessStride = 4;      // the sharpness is measured on every 4th sample, which every search scores
 
 Tracker::Tracker(const Config& conf) :
     mConfig(conf),
-    mClassifier(0), mFeature(0), mKernel(0), mScaleEstimator(0),
+    mClassifier(0), mFeature(0), mKernel(0), mUpdateFeature(0), mScaleEstimator(0),
     mDebugImage(2*(int)conf.mSearchRadius+1, 2*(int)conf.mSearchRadius+1, CV_32FC1)
 {
     Reset();
+    if(mConfig.mScaleType == Config::kScaleTypeAll)
+        mScalePool.reset(new WorkerPool(1));
 }
 
 void Tracker::Reset()
 {
+    stopUpdates();
     mInitialised = false;
     mDebugImage.setTo(0);
+    mRng.Seed(mConfig.mSeed);
+    mUpdateRng.Seed(mConfig.mSeed + 1);
 
     if(mClassifier) delete mClassifier;
+    if(mUpdateFeature && mUpdateFeature != mFeature) delete mUpdateFeature;
     if(mFeature) delete mFeature;
     if(mKernel) delete mKernel;
     if(mScaleEstimator) delete mScaleEstimator;
@@ -41,6 +62,12 @@ void Tracker::Reset()
 
     mNeedColor = false;
     mNeedHsv = false;
+    mNeedGrad = false;
+
+    // motion model
+    mSearchRadius = mConfig.mSearchRadius;
+    mVelocity = cv::Point2f(0.f, 0.f);
+    mInnovation = mSearchRadius / kRadiusGain;
 
     // scale
     mScale = 1.0f;
@@ -53,62 +80,89 @@ void Tracker::Reset()
     }
 
     // feature and kernel
+    mFeature = newFeature();
+    mUpdateFeature = mConfig.mAsyncUpdate ? newFeature() : mFeature;
+    switch (mConfig.mFeatureKernelPair.mKernel) {
+    case Config::kKernelTypeLinear:
+        mKernel = new LinearKernel();
+        break;
+//    case Config::kKernelTypeGaussian:
+//        mKernel = new GaussianKernel(mConfig.mFeatureKernelPair.mParams[0]);
+//        break;
+    case Config::kKernelTypeIntersection:
+        mKernel = new IntersectionKernel();
+        break;
+//    case Config::kKernelTypeChi2:
+//        mKernel = new Chi2Kernel();
+//        break;
+    default:
+        break;
+    }
+
+    // the background update draws from its own generator
+    mClassifier = new structuredSVM(mConfig, *mFeature, *mKernel, mConfig.mAsyncUpdate ? mUpdateRng : mRng);
+    mScaleEstimator = new ScaleEstimator();
+
+    mStageTimes = mConfig.mTimeStages ? &mTimes : 0;
+    mFeature->SetStageTimes(mStageTimes);
+    mUpdateFeature->SetStageTimes(mStageTimes);
+    mClassifier->SetStageTimes(mStageTimes);
+
+    mPendingUpdates = 0;
+    mStopUpdates = false;
+    if(mConfig.mAsyncUpdate)
+    {
+        mClassifier->SetDoubleBuffered(true);
+        startUpdates();
+    }
+}
+
+PatchFeature* Tracker::newFeature()
+{
+    PatchFeature* feature = 0;
     switch(mConfig.mFeatureKernelPair.mFeature) {
     case Config::kFeatureTypePatchGrad:
-        mFeature = new PatchGradFeature(mConfig);
+        feature = new PatchGradFeature(mConfig);
+        mNeedGrad = true;
         break;
     case Config::kFeatureTypePatchGray:
-        mFeature = new PatchGrayFeature(mConfig);
+        feature = new PatchGrayFeature(mConfig);
         break;
     case Config::kFeatureTypePatchGrayG:
-        mFeature = new PatchGrayGFeature(mConfig);
+        feature = new PatchGrayGFeature(mConfig);
+        mNeedGrad = true;
         break;
     case Config::kFeatureTypePatchHsv:
-        mFeature = new PatchHsvFeature(mConfig);
+        feature = new PatchHsvFeature(mConfig);
         mNeedColor = true;
         mNeedHsv = true;
         break;
     case Config::kFeatureTypePatchHsvG:
-        mFeature = new PatchHsvGFeature(mConfig);
+        feature = new PatchHsvGFeature(mConfig);
         mNeedColor = true;
         mNeedHsv = true;
+        mNeedGrad = true;
         break;
     case Config::kFeatureTypePatchRgb:
-        mFeature = new PatchRgbFeature(mConfig);
+        feature = new PatchRgbFeature(mConfig);
         mNeedColor = true;
         break;
     case Config::kFeatureTypePatchRgbG:
-        mFeature = new PatchRgbGFeature(mConfig);
+        feature = new PatchRgbGFeature(mConfig);
         mNeedColor = true;
+        mNeedGrad = true;
         break;
     default:
         break;
     }
-    switch (mConfig.mFeatureKernelPair.mKernel) {
-    case Config::kKernelTypeLinear:
-        mKernel = new LinearKernel();
-        break;
-//    case Config::kKernelTypeGaussian:
-//        mKernel = new GaussianKernel(mConfig.mFeatureKernelPair.mParams[0]);
-//        break;
-    case Config::kKernelTypeIntersection:
-        mKernel = new IntersectionKernel();
-        break;
-//    case Config::kKernelTypeChi2:
-//        mKernel = new Chi2Kernel();
-//        break;
-    default:
-        break;
-    }
-
-    mClassifier = new structuredSVM(mConfig, *mFeature, *mKernel);
-    mScaleEstimator = new ScaleEstimator();
-
+    return feature;
 }
 
 Tracker::~Tracker()
 {
+    stopUpdates();
     delete mClassifier;
+    if(mUpdateFeature != mFeature) delete mUpdateFeature;
     delete mFeature;
     delete mKernel;
     delete mScaleEstimator;
@@ -118,6 +172,10 @@ Tracker::~Tracker()
 
 void Tracker::Debug(const cv::Mat frame, const int frameIdx)
 {
+    // the classifier debug image needs the updates to be done
+    std::unique_lock<std::mutex> lock(mUpdateMutex);
+    mUpdateCond.wait(lock, [this] { return mPendingUpdates == 0; });
+
     // show score image
     cv::imshow("tracker", mDebugImage);
     // show classifier debug image
@@ -128,15 +186,24 @@ void Tracker::Debug(const cv::Mat frame, const int frameIdx)
 
 void Tracker::Initialise(const cv::Mat &frame, const FloatRect &bb)
 {
+    Initialise(ImageRep(frame, mNeedHsv, mNeedColor, mNeedGrad), bb);
+}
+
+void Tracker::Initialise(const ImageRep &image, const FloatRect &bb)
+{
+    assert(image.GetOrigin() == cv::Point(0, 0));
+    mFrameSize = image.GetGrayImage().size();
     mBb = FloatRect(bb);
     mInitBb = FloatRect(bb);
-    ImageRep image(frame, mNeedHsv, mNeedColor);
+    mTimes.Clear();
 
     UpdateClassifier(image);
+    if(mConfig.mAsyncUpdate)
+        publishModel();
 
     // initialize the scale estimator
     std::vector<cv::Point2f> pts;
-    mFeature->extractPatchPts(mBb, 5, pts);
+    mFeature->extractPatchPts(mBb, 5, mRng, pts);
     mScaleEstimator->initialize(image.GetGrayImage(), pts);
 
     mInitialised = true;
@@ -144,23 +211,113 @@ void Tracker::Initialise(const cv::Mat &frame, const FloatRect &bb)
 
 
 void Tracker::Track(const cv::Mat& frame)
+{
+    ScopedTimer imageTimer(mStageTimes, kStageImageRep);
+    ImageRep image(frame, GetSearchWindow(), mNeedHsv, mNeedColor, mNeedGrad);
+    imageTimer.Stop();
+    trackImage(image);
+}
+
+void Tracker::Track(const ImageRep &frameImage)
+{
+    IntRect window = GetSearchWindow();
+    const cv::Point& origin = frameImage.GetOrigin();
+    window.Translate(-origin.x, -origin.y);
+    assert(window.IsInside(frameImage.GetRect()));
+    trackImage(ImageRep(frameImage, window));
+}
+
+// the search around the position predicted by the motion model
+FloatRect Tracker::getSearchBb() const
+{
+    FloatRect searchBb(mBb);
+    if(mConfig.mAdaptiveRadius)
+    {
+        searchBb.SetXMin(std::max(0.f, std::min(mBb.XMin() + mVelocity.x, mFrameSize.width - mBb.Width())));
+        searchBb.SetYMin(std::max(0.f, std::min(mBb.YMin() + mVelocity.y, mFrameSize.height - mBb.Height())));
+    }
+    return searchBb;
+}
+
+IntRect Tracker::GetSearchWindow() const
+{
+    if(!mConfig.mWindowedImage)
+        return IntRect(0, 0, mFrameSize.width, mFrameSize.height);
+    return getSearchWindow(getSearchBb(), mFrameSize);
+}
+
+// score the translations of the target around searchBb as configured
+void Tracker::searchTranslation(const ImageRep &image, const FloatRect &searchBb, std::vector<FloatRect> &keptRects, std::vector<double> &scores)
+{
+    if(mConfig.mDenseSearch && mConfig.mFeatureKernelPair.mKernel == Config::kKernelTypeLinear)
+    {
+        // every translation of the dense score map is a sample
+        searchDense(image, searchBb, keptRects, scores);
+    }
+    else if(mConfig.mBoundedSearch && mConfig.mFeatureKernelPair.mKernel == Config::kKernelTypeLinear)
+    {
+        // score with early rejection of samples which cannot be the best
+        genOneScaleBBs(image, searchBb, keptRects);
+        int rejected = mFeature->EvalBoundedLinear(multiSample(image, keptRects), mClassifier->GetW(), kSharpnessStride, scores);
+        (void)rejected;
+#if VERBOSE
+        std::cout<<"bounded search rejected "<<rejected<<"/"<<keptRects.size()<<" samples"<<std::endl;
+#endif
+    }
+    else if(mConfig.mSearchStride > 1)
+    {
+        // only evaluate the samples on a coarse grid and around its best samples
+        searchCoarseToFine(image, searchBb, keptRects, scores);
+    }
+    else
+    {
+        genOneScaleBBs(image, searchBb, keptRects);
+        // evaluate all samples
+        // extract feature vector for all the samples
+        std::vector<Eigen::VectorXd> featVecs;
+        const_cast<PatchFeature*>(mFeature)->Eval(multiSample(image, keptRects), featVecs);
+        mClassifier->EvalMultiSamples(featVecs, scores);
+    }
+}
+
+// track in image, a window of the frame; the rest of the frame is tracked in its coordinates
+void Tracker::trackImage(const ImageRep& image)
 {
     assert(mInitialised);
 
-    ImageRep image(frame, mNeedHsv, mNeedColor);
-    std::vector<FloatRect> keptRects;
-    genOneScaleBBs(image, mBb, keptRects);
-    multiSample samples(image, keptRects);
+    // localize with a model which misses at most updateStaleness updates,
+    // the background update can only publish a new one between frames
+    std::unique_lock<std::mutex> lock(mUpdateMutex);
+    if(mConfig.mAsyncUpdate)
+        mUpdateCond.wait(lock, [this] { return mPendingUpdates <= mConfig.mUpdateStaleness; });
 
+    std::vector<FloatRect> keptRects;
     std::vector<double> scores;
-    // evaluate all samples
-    // extract feature vector for all the samples
     std::vector<Eigen::VectorXd> featVecs;
-    const_cast<PatchFeature*>(mFeature)->Eval(samples, featVecs);
-    mClassifier->EvalMultiSamples(featVecs, scores);
+
+    FloatRect searchBb = getSearchBb();
+    const cv::Point& origin = image.GetOrigin();
+    mBb.Translate(-origin.x, -origin.y);
+    searchBb.Translate(-origin.x, -origin.y);
+
+    // the scale estimator only reads the gray image, run it during the translation search
+    float scale = 1.f;
+    if(mScalePool)
+        mScalePool->Run(2, [&](int t) {
+            if(t == 0)
+            {
+                searchTranslation(image, searchBb, keptRects, scores);
+                return;
+            }
+            ScopedTimer timer(mStageTimes, kStageScaleEstimate);
+            scale = mScaleEstimator->estimateScale(image.GetGrayImage(), origin);
+        });
+    else
+        searchTranslation(image, searchBb, keptRects, scores);
+    multiSample samples(image, keptRects);
 
 
-    UpdateDebugImage(keptRects, mBb, scores);
+    UpdateDebugImage(keptRects, searchBb, scores);
 
     int bestInd = -1;
     getBestBB(scores, bestInd);
@@ -171,19 +328,25 @@ void Tracker::Track(const cv::Mat& frame)
 //    }
     assert(bestInd != -1);
 
+    // rejected samples of the bounded search have no score to fit a parabola through
+    FloatRect bestBb = keptRects[bestInd];
+    if(mConfig.mSubPixel && !(mConfig.mBoundedSearch && mConfig.mFeatureKernelPair.mKernel == Config::kKernelTypeLinear))
+        bestBb = refineSubPixel(keptRects, scores, bestInd);
+
+    if(mConfig.mAdaptiveRadius)
+        updateMotionModel(searchBb, bestBb, scores, bestInd);
+
     // update classifier and weight model
     if(mConfig.mScaleType == Config::kScaleTypeOne)
     {
-        mBb = keptRects[bestInd];
+        mBb = bestBb;
         // update classifier and weight model
         //   extract feature vector for the true sample
         const Eigen::VectorXd& tfv = const_cast<PatchFeature*>(mFeature)->Eval(samples.getSample(bestInd));
         double similarity = mClassifier->EvalTrueSample(tfv);
         if(similarity > kUpdateSimilarity)
-        {
-            UpdateClassifier(image);
-            UpdateWeightModel(samples.getSample(bestInd));
-        }
+            updateModel(image, mBb);
+        mBb.Translate(origin.x, origin.y);
         return;
     }
 
@@ -191,13 +354,12 @@ void Tracker::Track(const cv::Mat& frame)
     std::vector<FloatRect> scaleRects;
     if(mConfig.mScaleType == Config::kScaleTypeGradual)
     {
-        genGradualScaleBBs(image, keptRects[bestInd], scaleRects);
+        genGradualScaleBBs(image, bestBb, scaleRects);
     }
     else if (mConfig.mScaleType == Config::kScaleTypeAll)
     {
         // scaler estimation
-        float scale = mScaleEstimator->estimateScale(image.GetGrayImage());
-        genAllScaleBBs(image, keptRects[bestInd], scale, scaleRects);
+        genAllScaleBBs(image, bestBb, scale, scaleRects);
     }
     multiSample scaleSamples(image, scaleRects);
     scores.clear();
@@ -218,8 +380,8 @@ void Tracker::Track(const cv::Mat& frame)
 
     // update the scale estimator
     std::vector<cv::Point2f> pts;
-    mFeature->extractPatchPts(mBb, 5, pts);
-    mScaleEstimator->update(image.GetGrayImage(), pts);
+    mFeature->extractPatchPts(mBb, 5, mRng, pts);
+    mScaleEstimator->update(image.GetGrayImage(), pts, origin);
 
     // update classifier and weight model
     //  extract feature vector for the true sample
@@ -230,8 +392,7 @@ void Tracker::Track(const cv::Mat& frame)
 #endif
     if(similarity > kUpdateSimilarity)
     {
-        UpdateClassifier(image);
-        UpdateWeightModel(scaleSamples.getSample(bestInd));
+        updateModel(image, mBb);
     }
     else
     {
@@ -239,14 +400,19 @@ void Tracker::Track(const cv::Mat& frame)
         std::cout<<"similarity: "<<similarity<<" too low, no update!"<<std::endl;
 #endif
     }
-
+    mBb.Translate(origin.x, origin.y);
 }
 
 void Tracker::UpdateClassifier(const ImageRep &image)
+{
+    trainClassifier(image, mBb, mScale, *mFeature);
+}
+
+void Tracker::trainClassifier(const ImageRep &image, const FloatRect &bb, float scale, PatchFeature &feature)
 {
     std::vector<FloatRect> rects, keptRects;
-//    RadialSamples(mBb, mConfig.mSearchRadius, 5, 16, rects);
-    RadialSamples(mBb, 2*mConfig.mSearchRadius*mScale, 5, 16, rects);
+//    RadialSamples(bb, mConfig.mSearchRadius, 5, 16, rects);
+    RadialSamples(bb, 2*mConfig.mSearchRadius*scale, 5, 16, rects);
 
     keptRects.push_back(rects[0]);  // the true sample
     for(int i=1; i<(int)rects.size(); ++i)
@@ -262,35 +428,123 @@ void Tracker::UpdateClassifier(const ImageRep &image)
     multiSample samples(image, keptRects);
     // extract feature vector for the samples
     std::vector<Eigen::VectorXd> fvs;
-    const_cast<PatchFeature*>(mFeature)->Eval(samples, fvs);
+    feature.Eval(samples, fvs);
     mClassifier->Update(samples, fvs, 0);
 
 }
 
+// learn from the sample bb of image, on the update thread with asyncUpdate
+// (the caller holds mUpdateMutex then)
+void Tracker::updateModel(const ImageRep &image, const FloatRect &bb)
+{
+    if(!mConfig.mAsyncUpdate)
+    {
+        UpdateClassifier(image);
+        UpdateWeightModel(Sample(image, bb));
+        return;
+    }
+    float scale = mScale;
+    mUpdateJobs.push_back([this, image, bb, scale]() {
+        trainClassifier(image, bb, scale, *mUpdateFeature);
+        ScopedTimer timer(mStageTimes, kStageWeightModel);
+        mUpdateFeature->UpdateWeightModel(Sample(image, bb));
+    });
+    ++mPendingUpdates;
+    mUpdateCond.notify_all();
+}
+
+void Tracker::startUpdates()
+{
+    mUpdateThread = std::thread(&Tracker::runUpdates, this);
+}
+
+void Tracker::stopUpdates()
+{
+    if(!mUpdateThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mUpdateMutex);
+        mStopUpdates = true;
+    }
+    mUpdateCond.notify_all();
+    mUpdateThread.join();
+}
+
+// the update thread: runs the queued updates in order, each one is published
+// once no frame is being localized
+void Tracker::runUpdates()
+{
+    std::unique_lock<std::mutex> lock(mUpdateMutex);
+    while(true)
+    {
+        mUpdateCond.wait(lock, [this] { return mStopUpdates || !mUpdateJobs.empty(); });
+        if(mUpdateJobs.empty())
+            return;
+        std::function<void()> job = mUpdateJobs.front();
+        mUpdateJobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+        publishModel();
+        --mPendingUpdates;
+        mUpdateCond.notify_all();
+    }
+}
+
+void Tracker::publishModel()
+{
+    mClassifier->Publish();
+    mFeature->SetPatchWeights(mUpdateFeature->GetPatchWeights());
+}
+
 void Tracker::UpdateWeightModel(const Sample &s)
 {
+    ScopedTimer timer(mStageTimes, kStageWeightModel);
     const_cast<PatchFeature*>(mFeature)->UpdateWeightModel(s);
 }
 
 
 void Tracker::UpdateDebugImage(const std::vector<FloatRect>& samples, const FloatRect& centre, const std::vector<double>& scores)
 {
-    double mn = Eigen::VectorXd::Map(&scores[0], scores.size()).minCoeff();
-    double mx = Eigen::VectorXd::Map(&scores[0], scores.size()).maxCoeff();
+    // samples rejected by the bounded search (score -DBL_MAX) stay black
+    double mn = DBL_MAX;
+    double mx = -DBL_MAX;
+    for(int i=0; i < (int) scores.size(); ++i)
+    {
+        if(scores[i] == -DBL_MAX) continue;
+        mn = std::min(mn, scores[i]);
+        mx = std::max(mx, scores[i]);
+    }
     mDebugImage.setTo(0);
     for(int i=0; i < (int) samples.size(); ++i)
     {
+        if(scores[i] == -DBL_MAX) continue;
         int x = (int)(samples[i].XMin() - centre.XMin());
         int y = (int)(samples[i].YMin() - centre.YMin());
         mDebugImage.at<float>(mConfig.mSearchRadius+y, mConfig.mSearchRadius+x) = (float)((scores[i] - mn)/(mx-mn));
     }
 }
 
+// Part of the frame that the translation search, the scale search and the
+// classifier update around searchBb can reach, provided the target grows by at
+// most kWindowScale. Samples beyond it are dropped like samples off the frame.
+IntRect Tracker::getSearchWindow(const FloatRect &searchBb, const cv::Size &frameSize) const
+{
+    float reach = mSearchRadius + kScaleSearchRadius + 2*mConfig.mSearchRadius*mScale*kWindowScale + 1;
+    float padX = reach + (kWindowScale-1.f)/2 * searchBb.Width();
+    float padY = reach + (kWindowScale-1.f)/2 * searchBb.Height();
+    int x0 = std::max(0, (int)std::floor(searchBb.XMin() - padX));
+    int y0 = std::max(0, (int)std::floor(searchBb.YMin() - padY));
+    int x1 = std::min(frameSize.width, (int)std::ceil(searchBb.XMax() + padX));
+    int y1 = std::min(frameSize.height, (int)std::ceil(searchBb.YMax() + padY));
+    return IntRect(x0, y0, x1-x0, y1-y0);
+}
+
 void Tracker::genOneScaleBBs(const ImageRep &img, const FloatRect &centre, std::vector<FloatRect> &keptRects)
 {
     std::vector<FloatRect> rects;
     keptRects.clear();
-    float radius = mConfig.mSearchRadius;
+    float radius = mSearchRadius;
     PixelSamples(centre, radius, true, rects);
     for(int i=0; i<(int)rects.size(); ++i)
     {
@@ -300,101 +554,272 @@ void Tracker::genOneScaleBBs(const ImageRep &img, const FloatRect &centre, std::
 //    std::cout<<"one scale sample number: "<<keptRects.size() << std::endl;
 }
 
-void Tracker::genGradualScaleBBs(const ImageRep &img, const FloatRect &centre, std::vector<FloatRect> &rects)
+// prepare the features once for all samples within radius of centre
+void Tracker::prepareSearchDisk(const ImageRep &img, const FloatRect &centre, int radius)
 {
-    float w = centre.Width();
-    float h = centre.Height();
-    float xc = centre.XCentre();
-    float yc = centre.YCentre();
+    std::vector<FloatRect> corners;
+    corners.push_back(FloatRect(centre.XMin()-radius, centre.YMin()-radius, centre.Width(), centre.Height()));
+    corners.push_back(FloatRect(centre.XMin()+radius, centre.YMin()+radius, centre.Width(), centre.Height()));
+    mFeature->Prepare(multiSample(img, corners));
+}
 
-    FloatRect r;
-    for(int i = 0; i< mScales.size(); ++i)
+// the samples are all integer translations of centre within the search
+// radius which lie in the image, all scored at once by the dense score map
+void Tracker::searchDense(const ImageRep &img, const FloatRect &centre, std::vector<FloatRect> &keptRects, std::vector<double> &scores)
+{
+    keptRects.clear();
+    scores.clear();
+    int radius = (int)mSearchRadius;
+    int r2 = radius * radius;
+
+    prepareSearchDisk(img, centre, radius);
+
+    cv::Mat scoreMap;
+    mFeature->EvalDenseLinear(centre, radius, mClassifier->GetW(), scoreMap);
+
+    FloatRect s(centre);
+    for(int iy=-radius; iy<=radius; ++iy)
     {
-        r.SetWidth(w * mScales[i]);
-        r.SetHeight(h * mScales[i]);
-        r.SetXMin(xc - r.Width()/2);
-        r.SetYMin(yc - r.Height()/2);
-        if(!r.IsInside(img.GetRect()) || r.Width() < mInitBb.Width() * 0.2 || r.Height() < mInitBb.Height() * 0.2)
-            continue;
-        rects.push_back(r);
+        const double* sp = scoreMap.ptr<double>(radius+iy);
+        for(int ix=-radius; ix<=radius; ++ix)
+        {
+            if(ix*ix+iy*iy > r2 || sp[radius+ix] == -DBL_MAX) continue;
+            s.SetXMin((int)centre.XMin() + ix);
+            s.SetYMin((int)centre.YMin() + iy);
+            if(!s.IsInside(img.GetRect())) continue;
+            keptRects.push_back(s);
+            scores.push_back(sp[radius+ix]);
+        }
     }
-    // put radius = 5
-    int radius = 5;
+}
+
+void Tracker::searchCoarseToFine(const ImageRep &img, const FloatRect &centre, std::vector<FloatRect> &keptRects, std::vector<double> &scores)
+{
+    keptRects.clear();
+    scores.clear();
+    int radius = (int)mSearchRadius;
     int r2 = radius * radius;
-    for(int iy = -radius; iy<=radius; ++iy)
+    int side = 2*radius+1;
+    std::vector<char> visited(side*side, 0);
+    std::vector<cv::Point> keptOffsets;
+
+    prepareSearchDisk(img, centre, radius);
+
+    // first stage: coarse grid through the centre
+    int stride = mConfig.mSearchStride;
+    std::vector<cv::Point> offsets;
+    for(int iy=-(radius/stride)*stride; iy<=radius; iy+=stride)
+        for(int ix=-(radius/stride)*stride; ix<=radius; ix+=stride)
+            offsets.push_back(cv::Point(ix, iy));
+
+    std::vector<FloatRect> rects;
+    std::vector<double> stageScores;
+    std::vector<Eigen::VectorXd> featVecs;
+    FloatRect s(centre);
+    while(true)
     {
-        for(int ix=-radius; ix<=radius; ++ix)
+        rects.clear();
+        for(int i=0; i<(int)offsets.size(); ++i)
         {
-            if(ix*ix+iy*iy > r2) continue;
-            if(ix==0 && iy==0) continue;
-            for(int i=0; i<mScales.size(); ++i)
-            {
-                r.SetWidth(w * mScales[i]);
-                r.SetHeight(h * mScales[i]);
-                r.SetXMin(xc + ix - r.Width()/2);
-                r.SetYMin(yc + iy - r.Height()/2);
-                if(!r.IsInside(img.GetRect()) || r.Width() < mInitBb.Width() * 0.2 || r.Height() < mInitBb.Height() * 0.2)
-                    continue;
-                rects.push_back(r);
-            }
+            const cv::Point& o = offsets[i];
+            if(o.x*o.x+o.y*o.y > r2) continue;
+            char& v = visited[(o.y+radius)*side + o.x+radius];
+            if(v) continue;
+            v = 1;
+            s.SetXMin((int)centre.XMin() + o.x);
+            s.SetYMin((int)centre.YMin() + o.y);
+            if(!s.IsInside(img.GetRect())) continue;
+            rects.push_back(s);
+            keptOffsets.push_back(o);
+        }
+        if(!rects.empty())
+        {
+            mFeature->EvalPrepared(multiSample(img, rects), featVecs);
+            mClassifier->EvalMultiSamples(featVecs, stageScores);
+            keptRects.insert(keptRects.end(), rects.begin(), rects.end());
+            scores.insert(scores.end(), stageScores.begin(), stageScores.end());
+        }
+        if(stride == 1)
+            break;
+
+        // next stage: halve the stride around the best samples so far
+        std::vector<int> order(scores.size());
+        for(int i=0; i<(int)order.size(); ++i)
+            order[i] = i;
+        int topK = std::min(std::max(mConfig.mSearchTopK, 1), (int)order.size());
+        std::partial_sort(order.begin(), order.begin()+topK, order.end(),
+                          [&scores](int a, int b) { return scores[a] > scores[b]; });
+        stride /= 2;
+        offsets.clear();
+        for(int k=0; k<topK; ++k)
+        {
+            const cv::Point& o = keptOffsets[order[k]];
+            for(int dy=-stride; dy<=stride; dy+=stride)
+                for(int dx=-stride; dx<=stride; dx+=stride)
+                    offsets.push_back(cv::Point(o.x+dx, o.y+dy));
         }
     }
 }
 
+void Tracker::genGradualScaleBBs(const ImageRep &img, const FloatRect &centre, std::vector<FloatRect> &rects)
+{
+    std::vector<float> minRatios(mScales.size(), 0.2f);
+    genScaleSpaceBBs(img, centre, mScales, minRatios, rects);
+}
+
 void Tracker::genAllScaleBBs(const ImageRep &img, const FloatRect &centre, const float scale, std::vector<FloatRect> &rects)
 {
+    std::vector<float> scales(mScales);
+    std::vector<float> minRatios(mScales.size(), 0.2f);
 
-    genGradualScaleBBs(img, centre, rects);
+    if(scale != 1.0)
+    {
+        // abrupt scales between 1 and the estimated scale
+        double scale_step = (scale-1.0) / double(kAbruptScaleNum);
+        for(int i=0; i<kAbruptScaleNum; ++i)
+        {
+            scales.push_back(1.0 + i * scale_step);
+            minRatios.push_back(0.1f);
+        }
+    }
+    genScaleSpaceBBs(img, centre, scales, minRatios, rects);
 
-    if(scale == 1.0)
-        return;
+//     std::cout<<"all scale sample number: "<<rects.size() << std::endl;
+}
 
+// Samples of the given scales at every offset within radius 5 of centre. Scales
+// smaller than minRatios times the initial box are skipped, samples which
+// coincide at integer resolution are only kept once, and samples are grouped by
+// integer size so that the features can reuse one patch layout per group.
+void Tracker::genScaleSpaceBBs(const ImageRep &img, const FloatRect &centre, const std::vector<float> &scales,
+                               const std::vector<float> &minRatios, std::vector<FloatRect> &rects)
+{
+    rects.clear();
     float w = centre.Width();
     float h = centre.Height();
     float xc = centre.XCentre();
     float yc = centre.YCentre();
 
-    // todo
-    double scales[kAbruptScaleNum];
-    double scale_step = (scale-1.0) / double(kAbruptScaleNum);
-    for(int i=0; i<kAbruptScaleNum; ++i) {
-        scales[i] = 1.0 + i * scale_step;
-    }
-    FloatRect r;
-    for(int i=0; i<kAbruptScaleNum; ++i)
+    // group the scales by integer sample size
+    std::vector<cv::Size> sizes;
+    std::vector<std::vector<float> > groups;
+    for(int i=0; i<(int)scales.size(); ++i)
     {
-        r.SetWidth(w * scales[i]);
-        r.SetHeight(h * scales[i]);
-        r.SetXMin(xc - r.Width()/2);
-        r.SetYMin(yc - r.Height()/2);
-        if(!r.IsInside(img.GetRect()) || r.Width() < mInitBb.Width() * 0.1 || r.Height() < mInitBb.Height() * 0.1)
+        if(w * scales[i] < mInitBb.Width() * minRatios[i] || h * scales[i] < mInitBb.Height() * minRatios[i])
             continue;
-        rects.push_back(r);
+        cv::Size s((int)(w * scales[i]), (int)(h * scales[i]));
+        int k = (int)(std::find(sizes.begin(), sizes.end(), s) - sizes.begin());
+        if(k == (int)sizes.size())
+        {
+            sizes.push_back(s);
+            groups.push_back(std::vector<float>());
+        }
+        groups[k].push_back(scales[i]);
     }
-    // put radius = 5
-    int radius = 5;
+
+    int radius = kScaleSearchRadius;
     int r2 = radius * radius;
-    for(int iy = -radius; iy<=radius; ++iy)
+    FloatRect r;
+    for(int k=0; k<(int)groups.size(); ++k)
     {
-        for(int ix=-radius; ix<=radius; ++ix)
+        std::set<std::pair<int, int> > origins;
+        for(int i=0; i<(int)groups[k].size(); ++i)
         {
-            if(ix*ix+iy*iy > r2) continue;
-            if(ix==0 && iy==0) continue;
-            for(int i=0; i<kAbruptScaleNum; ++i)
+            r.SetWidth(w * groups[k][i]);
+            r.SetHeight(h * groups[k][i]);
+            for(int iy = -radius; iy<=radius; ++iy)
             {
-                r.SetWidth(w * scales[i]);
-                r.SetHeight(h * scales[i]);
-                r.SetXMin(xc + ix - r.Width()/2);
-                r.SetYMin(yc + iy - r.Height()/2);
-                if(!r.IsInside(img.GetRect()) || r.Width() < mInitBb.Width() * 0.1 || r.Height() < mInitBb.Height() * 0.1)
-                    continue;
-                rects.push_back(r);
+                for(int ix=-radius; ix<=radius; ++ix)
+                {
+                    if(ix*ix+iy*iy > r2) continue;
+                    r.SetXMin(xc + ix - r.Width()/2);
+                    r.SetYMin(yc + iy - r.Height()/2);
+                    if(!r.IsInside(img.GetRect()))
+                        continue;
+                    if(!origins.insert(std::make_pair((int)r.XMin(), (int)r.YMin())).second)
+                        continue;
+                    rects.push_back(r);
+                }
             }
         }
     }
+}
 
-//     std::cout<<"all scale sample number: "<<rects.size() << std::endl;
+// update the motion model from the translation search result, and choose the
+// search radius for the next frame from the smoothed prediction error
+void Tracker::updateMotionModel(const FloatRect &searchBb, const FloatRect &bestBb, const std::vector<double> &scores, int bestInd)
+{
+    float dx = bestBb.XCentre() - mBb.XCentre();
+    float dy = bestBb.YCentre() - mBb.YCentre();
+    float ex = bestBb.XCentre() - searchBb.XCentre();
+    float ey = bestBb.YCentre() - searchBb.YCentre();
+    float innovation = sqrtf(ex*ex + ey*ey);
+
+    mVelocity.x = (1-kVelocityRate) * mVelocity.x + kVelocityRate * dx;
+    mVelocity.y = (1-kVelocityRate) * mVelocity.y + kVelocityRate * dy;
+    mInnovation = (1-kInnovationRate) * mInnovation + kInnovationRate * innovation;
+
+    float maxRadius = mConfig.mSearchRadius;
+    float radius = std::max(kRadiusGain * mInnovation, kMinRadiusRatio * maxRadius);
+
+    // search wider if the best sample is close to the edge of the disk or does
+    // not stand out from the others. The spread of the scores is measured on
+    // every kSharpnessStride-th sample, which the bounded search never rejects,
+    // so that it does not depend on the samples rejected as low scorers
+    std::vector<double> scored;
+    for(int i=0; i<(int)scores.size(); i+=kSharpnessStride)
+        scored.push_back(scores[i]);
+    Eigen::VectorXd s = Eigen::VectorXd::Map(&scored[0], scored.size());
+    double mean = s.mean();
+    double sd = sqrt((s.array() - mean).square().mean());
+    if(innovation > kEdgeRatio * mSearchRadius || (sd > 0 && (scores[bestInd] - mean) / sd < kMinSharpness))
+        radius = std::max(radius, 2 * mSearchRadius);
+
+    mSearchRadius = std::min(radius, maxRadius);
+}
+
+// Sub-pixel position of the best translation sample: per axis, a parabola
+// through its score and the scores of the closest samples at the same distance
+// on either side. Axes without such samples or without a maximum keep the grid
+// position.
+FloatRect Tracker::refineSubPixel(const std::vector<FloatRect> &rects, const std::vector<double> &scores, int bestInd) const
+{
+    std::map<std::pair<int, int>, int> grid;
+    for(int i=0; i<(int)rects.size(); ++i)
+        grid[std::make_pair((int)rects[i].XMin(), (int)rects[i].YMin())] = i;
+
+    const int maxStep = std::max(2, mConfig.mSearchStride);
+    const int x0 = (int)rects[bestInd].XMin();
+    const int y0 = (int)rects[bestInd].YMin();
+    const double s0 = scores[bestInd];
+    FloatRect bb(rects[bestInd]);
+    for(int axis=0; axis<2; ++axis)
+    {
+        for(int d=1; d<=maxStep; ++d)
+        {
+            int dx = axis == 0 ? d : 0;
+            int dy = axis == 1 ? d : 0;
+            auto minus = grid.find(std::make_pair(x0-dx, y0-dy));
+            auto plus = grid.find(std::make_pair(x0+dx, y0+dy));
+            if(minus == grid.end() || plus == grid.end())
+                continue;
+            double sm = scores[minus->second];
+            double sp = scores[plus->second];
+            double curvature = sm - 2*s0 + sp;
+            if(curvature < 0)
+            {
+                float offset = d * std::max(-0.5, std::min(0.5, 0.5*(sm - sp)/curvature));
+                if(axis == 0)
+                    bb.SetXMin(x0 + offset);
+                else
+                    bb.SetYMin(y0 + offset);
+            }
+            break;
+        }
+    }
+    return bb;
 }
+
 void Tracker::getBestBB(const std::vector<double> &scores, int& bestInd)
 {
     double bestScore = -DBL_MAX;
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int workerNum) :
+    mWorkerNum(std::max(workerNum, 0)),
+    mTask(0),
+    mTaskNum(0),
+    mGeneration(0),
+    mPending(0),
+    mStop(false)
+{
+    for(int i=0; i<mWorkerNum; ++i)
+        mWorkers.push_back(std::thread(&WorkerPool::run, this, i));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCond.notify_all();
+    for(int i=0; i<(int)mWorkers.size(); ++i)
+        mWorkers[i].join();
+}
+
+void WorkerPool::Run(int n, const std::function<void(int)> &f)
+{
+    if(n <= 1 || mWorkerNum == 0)
+    {
+        for(int t=0; t<n; ++t)
+            f(t);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &f;
+        mTaskNum = n;
+        mPending = mWorkerNum;
+        ++mGeneration;
+    }
+    mCond.notify_all();
+    f(0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCond.wait(lock, [this] { return mPending == 0; });
+    mTask = 0;
+}
+
+void WorkerPool::run(int worker)
+{
+    int generation = 0;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(true)
+    {
+        mCond.wait(lock, [this, generation] { return mStop || mGeneration != generation; });
+        if(mStop)
+            return;
+        generation = mGeneration;
+        const std::function<void(int)>& f = *mTask;
+        int n = mTaskNum;
+
+        lock.unlock();
+        for(int t=worker+1; t<n; t+=mWorkerNum)
+            f(t);
+        lock.lock();
+
+        if(--mPending == 0)
+            mDoneCond.notify_one();
+    }
+}
@@ -160,7 +160,10 @@ bool writePrecisionFile(const std::string& filePath, const std::vector<float>& p
 }
 
 
-void scaleFrame(const float rWidth, const float rHeight, float &scaleWidth, float &scaleHeight)
+// working resolution of a sequence: small targets are upsampled to a shorter
+// side of 32 pixels, targets larger than maxArea pixels (if > 0) are
+// downsampled to maxArea, never making the shorter side smaller than 32
+void scaleFrame(const float rWidth, const float rHeight, float &scaleWidth, float &scaleHeight, const int maxArea)
 {
     float minLength = std::min(rWidth, rHeight);
 
@@ -169,6 +172,11 @@ void scaleFrame(const float rWidth, const float rHeight, float &scaleWidth, floa
         scaleWidth = 32.f / minLength;
         scaleHeight = scaleWidth;
     }
+    else if(maxArea > 0 && rWidth*rHeight > maxArea)
+    {
+        scaleWidth = std::max(std::sqrt(maxArea / (rWidth*rHeight)), 32.f / minLength);
+        scaleHeight = scaleWidth;
+    }
     else
     {
         scaleWidth = 1;
@@ -176,11 +184,25 @@ void scaleFrame(const float rWidth, const float rHeight, float &scaleWidth, floa
     }
 }
 
-void deinterlace(cv::Mat& m)
+// dst is src with every odd row replaced by the even row above it
+void deinterlace(const cv::Mat& src, cv::Mat& dst)
+{
+    dst.create(src.size(), src.type());
+    for(int i=0; i<src.rows; ++i)
+        src.row(i - i%2).copyTo(dst.row(i));
+}
+
+// scale frameOrig to frame with the OpenCV interpolation, deinterlaced if
+// asked for; frameOrig is not changed
+void prepareFrame(const cv::Mat &frameOrig, float scaleW, float scaleH, bool deinterlaceFrame, int interpolation, cv::Mat &frame)
 {
-    for(int i=0; i<m.rows; ++i)
-        if(i%2)
-            m.row(i-1).copyTo(m.row(i));
+    cv::Mat src;
+    if(deinterlaceFrame)
+        deinterlace(frameOrig, src);
+    else
+        src = frameOrig;
+    cv::resize(src, frame, cv::Size(std::round(frameOrig.cols*scaleW), std::round(frameOrig.rows*scaleH)),
+               0, 0, interpolation);
 }
 
 float mod(float a, float b)
@@ -191,14 +213,6 @@ float mod(float a, float b)
     return ret;
 }
 
-float RandomFloat(float a, float b)
-{
-    float random = ((float) rand()) / (float) RAND_MAX;
-    float diff = b - a;
-    float r = random * diff;
-    return a + r;
-}
-
 
 void getUnionRect(const std::vector<FloatRect> &rects, FloatRect& union_r)
 {
@@ -1,7 +1,16 @@
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <opencv/highgui.h>
 #include <opencv2/opencv.hpp>
+#include "CameraCapture.h"
 #include "Config.h"
+#include "FramePrefetcher.h"
+#include "FrameSource.h"
+#include "FrameTracker.h"
+#include "MultiTracker.h"
 #include "Rect.h"
 #include "mUtils.h"
 #include "Tracker.h"
@@ -70,24 +79,142 @@ void chooseRoi(const cv::Mat& img)
     cv::destroyWindow("choose roi");
 }
 
-bool trackSequence(Config& conf, const int seqIdx)
+// track all targets, given by their boxes in the first frame, in the frames of source;
+// firstFrame is already read
+bool trackTargets(Config& conf, FrameSource& source, cv::Mat& firstFrame, int startFrame, int endFrame,
+                  const std::vector<FloatRect>& targets)
+{
+    bool paused = false;
+    std::string seqPath = conf.mSeqBasePath+"/"+conf.mSeqName+"/";
+    std::string imgResultFormat;
+    char imgPath[256];
+    if(conf.mSaveFrame)
+    {
+        mkdir(seqPath+"result/");
+        imgResultFormat = seqPath+"result/r_%04d.jpg";
+    }
+    if(firstFrame.empty())
+    {
+        std::cout << "error: could not read frame: " << startFrame << std::endl;
+        return false;
+    }
+
+    // one tracker per target on the shared frame representation
+    MultiTracker tracker(conf);
+    if(!conf.mQuietMode)
+    {
+        cv::namedWindow("result");
+    }
+    tracker.Initialise(firstFrame, targets);
+
+    // the frames after the first are read and preprocessed ahead on decode threads
+    std::unique_ptr<FramePrefetcher> prefetcher;
+    if(conf.mDecodeThreads > 0)
+        prefetcher.reset(new FramePrefetcher(source, startFrame+1, endFrame, tracker.GetScaleW(), tracker.GetScaleH(),
+                                             conf.mDeinterlace, tracker.GetInterpolation(), conf.mDecodeThreads));
+
+    std::vector<std::vector<FloatRect> > rBBs(targets.size());
+    for(int frameInd = startFrame; frameInd<=endFrame; ++frameInd)
+    {
+        cv::Mat frame, frameOrig, result;
+        if(frameInd == startFrame)
+        {
+            frameOrig = firstFrame;
+        }
+        else
+        {
+            if(prefetcher)
+                prefetcher->Next(frameOrig, frame);
+            else
+                source.Read(frameInd, frameOrig);
+            if(frameOrig.empty())
+            {
+                // end of a video or stream
+                if(!source.IsRandomAccess())
+                    break;
+                std::cout << "error: could not read frame: " << frameInd << std::endl;
+                continue;
+            }
+            if(frame.empty())
+                tracker.Track(frameOrig);
+            else
+                tracker.TrackPrepared(frame);
+        }
+
+        // store the bounding boxes
+        const std::vector<FloatRect>& bbs = tracker.GetBBs();
+        for(int i=0; i<(int)bbs.size(); ++i)
+            rBBs[i].push_back(bbs[i]);
+        //  save the result image or not
+        if(conf.mSaveFrame)
+        {
+            sprintf(imgPath, imgResultFormat.c_str(), frameInd);
+            for(int i=0; i<(int)bbs.size(); ++i)
+                rectangle(frameOrig, bbs[i], COLOR_CYAN, 3);
+            cv::imwrite(imgPath, frameOrig);
+        }
+
+        // show the tracking result or not
+        if(!conf.mQuietMode)
+        {
+            tracker.GetFrame().copyTo(result);
+            for(int i=0; i<tracker.GetTargetNum(); ++i)
+                rectangle(result, tracker.GetTracker(i)->getBB(), COLOR_CYAN, 3);
+            cv::putText(result, std::to_string(frameInd)+'/'+std::to_string(endFrame), cv::Point(10, 20), cv::FONT_HERSHEY_COMPLEX, 0.4, CV_RGB(0, 255, 0));
+            cv::imshow("result", result);
+            int key = cv::waitKey(paused ? 0 : 1);
+            if (key != -1)
+            {
+                if (key == 27 || key == 113) // esc q
+                {
+                    break;
+                }
+                else if (key == 112) // p
+                {
+                    paused = !paused;
+                }
+            }
+        }
+    }
+
+    // save the result bounding boxes or not
+    if(conf.mSaveBB)
+    {
+        for(int i=0; i<(int)rBBs.size(); ++i)
+            writeResultBBFile(seqPath+"target"+std::to_string(i)+"_"+conf.mBbFileName, rBBs[i]);
+    }
+
+    tracker.Reset();
+    if(conf.mTimeStages)
+    {
+        for(int i=0; i<tracker.GetTargetNum(); ++i)
+            tracker.GetTracker(i)->getStageTimes().Write(seqPath+"target"+std::to_string(i)+"_"+conf.mTimesFileName);
+    }
+    return true;
+}
+
+// track sequence seqIdx of conf (or the camera), prec receives the precision
+// curve of the sequence if it is computed
+bool trackSequence(Config& conf, const int seqIdx, std::vector<float>* prec = 0)
 {
-    bool deinterlace_flag = false;
     bool paused = false;
 
     int startFrame, endFrame;
-    float scaleW, scaleH;
     FloatRect initBB;
     bool gt_flag;
-    std::string framesFilePath, gtFilePath, imgFormat, imgResultFormat;
+    std::string framesFilePath, gtFilePath, imgResultFormat;
     std::vector<FloatRect> gtBBs, rBBs;
     char imgPath[256];
 
-    cv::VideoCapture cap;
+    std::unique_ptr<CameraCapture> camera;
+    std::unique_ptr<FrameSource> source;
+    bool prepared = false;  // frames from a frame cache, already scaled and read-only
+    cv::Mat firstFrame;
     if(conf.mUseCamera)
     {
-        cap = cv::VideoCapture(0);
-        if(!cap.open(0))
+        // the latest frame wins, frames are dropped while the tracker is busy
+        camera.reset(new CameraCapture(0, conf.mCameraMaxAge));
+        if(!camera->IsOpened())
         {
             std::cout <<"error: could not start camera capture" << std::endl;
             return false;
@@ -105,11 +232,40 @@ bool trackSequence(Config& conf, const int seqIdx)
         framesFilePath = conf.mSeqBasePath + "/" + conf.mSeqName + "/" + conf.mSeqName+"_frames.txt";
         // read startFrame and endFrame from frames file
         if(!readFramesFile(framesFilePath, startFrame, endFrame))
-            return false;
+        {
+            // videos and streams can also be tracked to their end
+            if(conf.mInputType == Config::kInputTypeImages)
+                return false;
+            startFrame = 1;
+            endFrame = INT_MAX;
+        }
         gtFilePath = conf.mSeqBasePath+"/"+conf.mSeqName+"/"+conf.mSeqName+"_gt.txt";
         // read ground truth bounding box from gt file
         gt_flag = readGtFile(gtFilePath, gtBBs);
-        imgFormat = conf.mSeqBasePath+"/"+conf.mSeqName+"/img/"+"%04d.jpg";
+        source.reset(FrameSource::Create(conf, startFrame));
+        if(!source)
+            return false;
+        source->Read(startFrame, firstFrame);
+        prepared = source->IsPrepared();
+        if(prepared && (!gt_flag || !conf.mTargetsFile.empty()))
+        {
+            std::cout << "error: the frame cache is scaled for the ground truth target" << std::endl;
+            return false;
+        }
+        if(prepared && conf.mSaveFrame)
+        {
+            std::cout << "the frames of the frame cache are not saved" << std::endl;
+            conf.mSaveFrame = false;
+        }
+
+        // several targets, given by their initial boxes
+        if(!conf.mTargetsFile.empty())
+        {
+            std::vector<FloatRect> targets;
+            if(!readGtFile(conf.mSeqBasePath+"/"+conf.mSeqName+"/"+conf.mTargetsFile, targets) || targets.empty())
+                return false;
+            return trackTargets(conf, *source, firstFrame, startFrame, endFrame, targets);
+        }
     }
     if(conf.mSaveFrame)
     {
@@ -131,7 +287,8 @@ bool trackSequence(Config& conf, const int seqIdx)
             while(true)
             {
                 cv::Mat tmp;
-                cap >> tmp;
+                if(!camera->Read(tmp))
+                    return false;
                 img = tmp.clone();
                 cv::putText(tmp,"Prese 'ESC' to start choose roi", cv::Point(10, 20), cv::FONT_HERSHEY_COMPLEX, 0.4, CV_RGB(0, 255, 0));
                 cv::imshow("camera", tmp);
@@ -146,121 +303,122 @@ bool trackSequence(Config& conf, const int seqIdx)
         }
         else
         {
-            sprintf(imgPath, imgFormat.c_str(), startFrame);
-            img = cv::imread(imgPath, cv::IMREAD_COLOR);
+            img = firstFrame;
         }
         // manually set the initial bounding box
         cv::namedWindow("choose roi");
         cv::setMouseCallback("choose roi", chooseRoiCallBack);
         chooseRoi(img);
+        initBB = roi;
     }
-
-    if(gt_flag) {
-        initBB = gtBBs[0]; }
-    else {
-        initBB = roi; }
-
-
-    // scale the bounding box
-    if(conf.mUseCamera)
+    else
     {
-        scaleW = 0.3;
-        scaleH = 0.3;
+        initBB = gtBBs[0];
     }
-    else
+
+    // the frame cache must be scaled like the tracker would scale the frames
+    if(prepared)
     {
-        scaleFrame(initBB.Width(), initBB.Height(), scaleW, scaleH);
+        float scaleW, scaleH;
+        FrameTracker::GetFrameScale(conf, initBB, scaleW, scaleH);
+        if(std::fabs(scaleW - source->GetScaleW()) > 1e-6 || std::fabs(scaleH - source->GetScaleH()) > 1e-6)
+        {
+            std::cout << "error: the frame cache is scaled by " << source->GetScaleW() << "x" << source->GetScaleH()
+                      << " instead of " << scaleW << "x" << scaleH << ", write it again with PAWSS_cache" << std::endl;
+            return false;
+        }
     }
-    initBB = FloatRect(initBB.XMin()*scaleW, initBB.YMin()*scaleH, initBB.Width()*scaleW, initBB.Height()*scaleH);
-    conf.mSearchRadius = std::round((initBB.Width()+initBB.Height())/2);
 
-    // declare the tracker
-    Tracker tracker(conf);
-    srand(conf.mSeed);
+
+    // declare the tracker, it scales the frames for the target
+    FrameTracker tracker(conf);
     if(!conf.mQuietMode)
     {
         cv::namedWindow("result");
     }
 
+    // the frames after the first are read and preprocessed ahead on decode threads
+    std::unique_ptr<FramePrefetcher> prefetcher;
+
     rBBs.clear();
+    int droppedBefore = camera ? camera->GetDropped() : 0;
+    int readBefore = camera ? camera->GetRead() : 0;
     for(int frameInd = startFrame; frameInd<=endFrame; ++frameInd)
     {
         cv::Mat frame, frameOrig, result;
 
         if(conf.mUseCamera)
         {
-            cap >> frameOrig;
+            if(!camera->Read(frameOrig))
+                break;
         }
         else
         {
-            sprintf(imgPath, imgFormat.c_str(), frameInd);
-            frameOrig = cv::imread(imgPath, cv::IMREAD_COLOR);
+            if(frameInd == startFrame)
+                frameOrig = firstFrame;
+            else if(prefetcher)
+                prefetcher->Next(frameOrig, frame);
+            else
+                source->Read(frameInd, frameOrig);
             if(frameOrig.empty())
             {
-                std::cout << "error: could not read frame: " << imgPath << std::endl;
-                if(gt_flag)
+                // end of a video or stream
+                if(!source->IsRandomAccess())
+                    break;
+                std::cout << "error: could not read frame: " << frameInd << std::endl;
+                if(gt_flag || frameInd == startFrame)
                     return false;
                 else
                     continue;
             }
+            if(prepared)
+                frame = frameOrig;
         }
 
-        // deinterlace the frame or not
-        if(!deinterlace_flag){
-            deinterlace(frameOrig); }
-        // scale the frame
-        cv::resize(frameOrig, frame, cv::Size(std::round(frameOrig.cols*scaleW), std::round(frameOrig.rows*scaleH)));
-
+        FloatRect r;
         if(frameInd == startFrame)
         {
-            tracker.Initialise(frame, initBB);
-            FloatRect r(initBB.XMin()/scaleW, initBB.YMin()/scaleH, initBB.Width()/scaleW, initBB.Height()/scaleH);
-            if(!conf.mUseCamera)
-            {
-                // store the bounding box
-                rBBs.push_back(r);
-            }
-            //  save the result image or not
-            if(conf.mSaveFrame)
-            {
-                sprintf(imgPath, imgResultFormat.c_str(), frameInd);
-                rectangle(frameOrig, r, COLOR_CYAN, 3);
-                cv::imwrite(imgPath, frameOrig);
-            }
+            if(prepared)
+                tracker.InitialisePrepared(frame, initBB);
+            else
+                tracker.Initialise(frameOrig, initBB);
+            r = tracker.GetBB();
+            if(!conf.mUseCamera && !prepared && conf.mDecodeThreads > 0)
+                prefetcher.reset(new FramePrefetcher(*source, startFrame+1, endFrame, tracker.GetScaleW(), tracker.GetScaleH(),
+                                                     conf.mDeinterlace, tracker.GetInterpolation(), conf.mDecodeThreads));
         }
-        if(tracker.isInitialised())
+        else if(frame.empty())
         {
-            tracker.Track(frame);
-
-            if(frameInd != startFrame)
-            {
-                const FloatRect& bb = tracker.getBB();
-                FloatRect r(bb.XMin()/scaleW, bb.YMin()/scaleH, bb.Width()/scaleW, bb.Height()/scaleH);
-                if(!conf.mUseCamera)
-                {
-                    // store the bounding box
-                    rBBs.push_back(r);
-                }
-                //  save the result image or not
-                if(conf.mSaveFrame)
-                {
-                    sprintf(imgPath, imgResultFormat.c_str(), frameInd);
-                    rectangle(frameOrig, r, COLOR_CYAN, 3);
-                    cv::imwrite(imgPath, frameOrig);
-                }
-            }
+            r = tracker.Track(frameOrig);
+        }
+        else
+        {
+            r = tracker.TrackPrepared(frame);
+        }
 
-            if(!conf.mQuietMode && conf.mDebugMode){
-                tracker.Debug(frame, frameInd);}
+        if(!conf.mUseCamera)
+        {
+            // store the bounding box
+            rBBs.push_back(r);
+        }
+        //  save the result image or not
+        if(conf.mSaveFrame)
+        {
+            sprintf(imgPath, imgResultFormat.c_str(), frameInd);
+            rectangle(frameOrig, r, COLOR_CYAN, 3);
+            cv::imwrite(imgPath, frameOrig);
         }
 
+        if(!conf.mQuietMode && conf.mDebugMode){
+            tracker.GetTracker()->Debug(tracker.GetFrame(), frameInd);}
+
         // show the tracking result or not
         if(!conf.mQuietMode)
         {
-            frame.copyTo(result);
-            rectangle(result, tracker.getBB(), COLOR_CYAN, 3);
+            tracker.GetFrame().copyTo(result);
+            rectangle(result, tracker.GetTracker()->getBB(), COLOR_CYAN, 3);
             cv::putText(result, std::to_string(frameInd)+'/'+std::to_string(endFrame), cv::Point(10, 20), cv::FONT_HERSHEY_COMPLEX, 0.4, CV_RGB(0, 255, 0));
-            cv::putText(result, std::to_string(tracker.getScale()), cv::Point(10, 40), cv::FONT_HERSHEY_COMPLEX, 0.4, CV_RGB(0, 255, 0));
+            cv::putText(result, std::to_string(tracker.GetTracker()->getScale()), cv::Point(10, 40), cv::FONT_HERSHEY_COMPLEX, 0.4, CV_RGB(0, 255, 0));
             cv::imshow("result", result);
             int key = cv::waitKey(paused ? 0 : 1);
             if (key != -1)
@@ -286,27 +444,110 @@ bool trackSequence(Config& conf, const int seqIdx)
     // If there is ground truth and you want to evaluate the precision of the tracking result
     if(conf.mPrecision && gt_flag)
     {
-        // evaluate presicion rate
-        std::vector<float> prec = estPrecision(rBBs, gtBBs);
-        std::string precFilePath = conf.mSeqBasePath+"/"+conf.mSeqName+"/"+conf.mPrecFileName;
-        writePrecisionFile(precFilePath, prec);
+        // a video or stream without frames file is tracked to its end, which
+        // need not be the end of its ground truth: compare the common frames
+        size_t frameNum = std::min(rBBs.size(), gtBBs.size());
+        if(frameNum == 0)
+        {
+            std::cout << "no tracked frames with ground truth, precision not evaluated" << std::endl;
+        }
+        else
+        {
+            // evaluate presicion rate
+            rBBs.resize(frameNum);
+            gtBBs.resize(frameNum);
+            std::vector<float> seqPrec = estPrecision(rBBs, gtBBs);
+            std::string precFilePath = conf.mSeqBasePath+"/"+conf.mSeqName+"/"+conf.mPrecFileName;
+            writePrecisionFile(precFilePath, seqPrec);
+            if(prec) {
+                *prec = seqPrec; }
+        }
     }
 
     tracker.Reset();
-    cap.release();
+    if(conf.mTimeStages && !conf.mUseCamera && tracker.GetTracker())
+    {
+        std::string timesFilePath = conf.mSeqBasePath+"/"+conf.mSeqName+"/"+conf.mTimesFileName;
+        tracker.GetTracker()->getStageTimes().Write(timesFilePath);
+    }
+    if(camera)
+    {
+        std::cout << "tracked " << camera->GetRead() - readBefore << " camera frames, dropped "
+                  << camera->GetDropped() - droppedBefore << std::endl;
+    }
     return true;
 }
 
-int main(int argc, char* argv[])
+// whether the initial box of sequence seqIdx must be chosen in a window
+bool needsRoi(const Config& conf, int seqIdx)
 {
-    std::string configPath;
-    if(argc > 1)
+    if(!conf.mTargetsFile.empty())
+        return false;
+    const std::string& seqName = conf.mSeqNames[seqIdx];
+    std::vector<FloatRect> gtBBs;
+    return !readGtFile(conf.mSeqBasePath+"/"+seqName+"/"+seqName+"_gt.txt", gtBBs);
+}
+
+// track the sequences of conf on jobNum threads, each with its own copy of conf
+void trackSequences(const Config& conf, int jobNum, std::vector<std::vector<float> >& precs)
+{
+    int seqNum = conf.mSeqNames.size();
+    precs.assign(seqNum, std::vector<float>());
+    std::atomic<int> nextSeq(0);
+    auto job = [&conf, &precs, &nextSeq, seqNum]()
+    {
+        Config jobConf(conf);
+        for(int i = nextSeq++; i < seqNum; i = nextSeq++)
+            trackSequence(jobConf, i, &precs[i]);
+    };
+
+    std::vector<std::thread> threads;
+    for(int t=1; t<jobNum; ++t)
+        threads.push_back(std::thread(job));
+    job();
+    for(int t=0; t<(int)threads.size(); ++t)
+        threads[t].join();
+}
+
+// mean precision curve of the sequences with ground truth
+void writeMeanPrecision(const Config& conf, const std::vector<std::vector<float> >& precs)
+{
+    std::vector<float> mean;
+    int n = 0;
+    for(int i=0; i<(int)precs.size(); ++i)
     {
-        configPath = argv[1];
+        if(precs[i].empty())
+            continue;
+        mean.resize(precs[i].size(), 0.f);
+        for(int j=0; j<(int)mean.size(); ++j)
+            mean[j] += precs[i][j];
+        ++n;
     }
-    else
+    if(n == 0)
+        return;
+    for(int j=0; j<(int)mean.size(); ++j)
+        mean[j] /= n;
+
+    std::string precFilePath = conf.mSeqBasePath+"/"+conf.mPrecFileName;
+    writePrecisionFile(precFilePath, mean);
+    if(mean.size() > 20)
+        std::cout << "mean precision at 20 pixels over " << n << " sequences: " << mean[20] << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    // usage: PAWSS [config] [--jobs N]
+    std::string configPath = "./config.txt";
+    int jobNum = 1;
+    for(int i=1; i<argc; ++i)
     {
-        configPath = "./config.txt";
+        std::string arg = argv[i];
+        if(arg == "--jobs" && i+1 < argc)
+            jobNum = std::max(1, atoi(argv[++i]));
+        else if(arg.compare(0, 7, "--jobs=") == 0)
+            jobNum = std::max(1, atoi(arg.c_str()+7));
+        else
+            configPath = arg;
     }
 
     // read config file
@@ -325,10 +566,27 @@ int main(int argc, char* argv[])
     else
     {
         int seqNum = conf.mSeqNames.size();
-        for(int i=0; i<seqNum; ++i)
+        jobNum = std::min(jobNum, seqNum);
+        // the roi is chosen with HighGUI, which only works on the main thread
+        for(int i=0; jobNum > 1 && i<seqNum; ++i)
+        {
+            if(needsRoi(conf, i))
+            {
+                std::cout << "error: sequence " << conf.mSeqNames[i]
+                          << " has no ground truth to start from, track it without --jobs" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        if(jobNum > 1 && !conf.mQuietMode)
         {
-            trackSequence(conf, i);
+            // the windows cannot be shared between jobs
+            std::cout << "tracking " << jobNum << " sequences at a time, quiet mode on" << std::endl;
+            conf.mQuietMode = true;
         }
+        std::vector<std::vector<float> > precs;
+        trackSequences(conf, std::max(jobNum, 1), precs);
+        if(conf.mPrecision && seqNum > 1)
+            writeMeanPrecision(conf, precs);
     }
 
     return EXIT_SUCCESS;
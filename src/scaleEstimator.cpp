@@ -8,25 +8,26 @@ ScaleEstimator::~ScaleEstimator()
     mStatus.clear();
 }
 
-void ScaleEstimator::initialize(const cv::Mat &prevImg, const std::vector<cv::Point2f> &prevPts)
+void ScaleEstimator::initialize(const cv::Mat &prevImg, const std::vector<cv::Point2f> &prevPts, const cv::Point &origin)
 {
     assert(prevImg.channels() == 1);
     setPrevImg(prevImg);
     setPrevPts(prevPts);
+    mPrevOrigin = origin;
     mCurrPts.reserve(mPrevPts.size());
     mStatus.reserve(mPrevPts.size());
 }
 
-void ScaleEstimator::update(const cv::Mat &prevImg, const std::vector<cv::Point2f> &prevPts)
+void ScaleEstimator::update(const cv::Mat &prevImg, const std::vector<cv::Point2f> &prevPts, const cv::Point &origin)
 {
-    initialize(prevImg, prevPts);
+    initialize(prevImg, prevPts, origin);
 }
 
 
 
-float ScaleEstimator::estimateScale(const cv::Mat &currImg)
+float ScaleEstimator::estimateScale(const cv::Mat &currImg, const cv::Point &origin)
 {
-    trackPts(currImg);
+    trackPts(currImg, origin);
 
     int trackedNum = 0;
     for(int i=0; i<mStatus.size(); ++i) {
@@ -62,9 +63,21 @@ float ScaleEstimator::estimateScale(const cv::Mat &currImg)
     return pairRatios[pairRatios.size()/2];
 }
 
-void ScaleEstimator::trackPts(const cv::Mat &currImg)
+void ScaleEstimator::trackPts(const cv::Mat &currImg, const cv::Point &origin)
 {
     assert(currImg.channels() == 1);
     std::vector<float> err;
-    cv::calcOpticalFlowPyrLK(mPrevImg, currImg, mPrevPts, mCurrPts, mStatus, err);
+    if(origin == mPrevOrigin)
+    {
+        cv::calcOpticalFlowPyrLK(mPrevImg, currImg, mPrevPts, mCurrPts, mStatus, err);
+        return;
+    }
+    // start the search at the previous positions in the coordinates of currImg
+    cv::Point2f shift(mPrevOrigin - origin);
+    mCurrPts.resize(mPrevPts.size());
+    for(int i=0; i<(int)mPrevPts.size(); ++i)
+        mCurrPts[i] = mPrevPts[i] + shift;
+    cv::calcOpticalFlowPyrLK(mPrevImg, currImg, mPrevPts, mCurrPts, mStatus, err, cv::Size(21, 21), 3,
+                             cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01),
+                             cv::OPTFLOW_USE_INITIAL_FLOW);
 }
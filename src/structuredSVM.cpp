@@ -2,23 +2,33 @@
 #include "structuredSVM.h"
 #include "Config.h"
 #include "Kernels.h"
+#include "Rng.h"
 #include "Features/PatchFeature.h"
 #include "Sample.h"
 #include "ImageRep.h"
+#include "StageTimer.h"
+#include "WorkerPool.h"
 #include "GraphUtils/GraphUtils.h"
 
 static const int kTileSize = 30;
-static const int kMaxSVs =  2000;  // TODO (only used when no budget)
+static const int kMinKernelSize = 64;  // initial kernel matrix size when no budget
+static const int kOptimizeNum = 10;
 
-structuredSVM::structuredSVM(const Config &conf, const Feature& feature, const Kernel &kernel) :
+structuredSVM::structuredSVM(const Config &conf, const Feature& feature, const Kernel &kernel, Rng &rng) :
     mConfig(conf),
     mKernel(kernel),
-    mC(conf.mSvmC)
+    mRng(rng),
+    mC(conf.mSvmC),
+    mDoubleBuffered(false),
+    mTimes(0)
 {
-    int N = conf.mSvmBudgetSize > 0 ? conf.mSvmBudgetSize+2 : kMaxSVs;
+    int N = conf.mSvmBudgetSize > 0 ? conf.mSvmBudgetSize+2 : kMinKernelSize;
     mK = Eigen::MatrixXd::Zero(N, N);
     mW = Eigen::VectorXd(feature.GetCount());
     mDebugImage = cv::Mat(800, 600, CV_8UC3);
+    // the sweeps run on the calling thread and svmThreads-1 workers, started once
+    if(conf.mSvmThreads > 1)
+        mPool.reset(new WorkerPool(conf.mSvmThreads-1));
 }
 
 structuredSVM::~structuredSVM()
@@ -26,6 +36,35 @@ structuredSVM::~structuredSVM()
 
 }
 
+// run f(0), ..., f(n-1) on n threads of the pool, f(0) on the calling thread
+void structuredSVM::parallelRun(int n, const std::function<void(int)> &f)
+{
+    if(mPool)
+        mPool->Run(n, f);
+    else
+        for(int t=0; t<n; ++t)
+            f(t);
+}
+
+void structuredSVM::SetDoubleBuffered(bool doubleBuffered)
+{
+    mDoubleBuffered = doubleBuffered;
+    if(mDoubleBuffered)
+        Publish();
+}
+
+void structuredSVM::Publish()
+{
+    mWFront = mW;
+    mFrontB.resize(mSvs.size());
+    mFrontX.resize(mSvs.size());
+    for(int i=0; i<(int)mSvs.size(); ++i)
+    {
+        mFrontB[i] = mSvs[i]->b;
+        mFrontX[i] = mSvs[i]->x->x[mSvs[i]->y];
+    }
+}
+
 void structuredSVM::Update(const multiSample &samples, const std::vector<Eigen::VectorXd> &featVecs, int y)
 {
     // add new support pattern
@@ -55,6 +94,10 @@ void structuredSVM::Update(const multiSample &samples, const std::vector<Eigen::
 //    const_cast<Feature&>(mFeature).Eval(samples, sp->x);
     sp->y = y;
     sp->refCount = 0;
+    // the loss only depends on the (fixed) sample rects, compute it once
+    sp->loss.resize(sp->yv.size());
+    for(int i=0; i<(int)sp->yv.size(); ++i)
+        sp->loss[i] = Loss(sp->yv[i], sp->yv[y]);
     mSps.push_back(sp);
 
     ProcessNew((int)mSps.size()-1);
@@ -85,6 +128,7 @@ void structuredSVM::Debug()
 
 void structuredSVM::EvalMultiSamples(const std::vector<Eigen::VectorXd> &fvs, std::vector<double> &scores) const
 {
+    ScopedTimer timer(mTimes, kStageEvalSamples);
 
 //    const_cast<Feature&>(mFeature).Eval(samples, fvs);
 
@@ -94,6 +138,11 @@ void structuredSVM::EvalMultiSamples(const std::vector<Eigen::VectorXd> &fvs, st
         for(int i=0; i<(int)fvs.size(); ++i) {
             scores[i] = Test(fvs[i]); }
     }
+    else if(mDoubleBuffered)
+    {
+        for(int i=0; i<(int)fvs.size(); ++i) {
+            scores[i] = EvaluateFront(fvs[i]); }
+    }
     else
     {
         for(int i=0; i<(int)fvs.size(); ++i) {
@@ -107,13 +156,27 @@ double structuredSVM::EvalTrueSample(const Eigen::VectorXd &tfv) const
     double sim = 0.0;
     int numPsv = 0;
 //    const Eigen::VectorXd tfv = const_cast<Feature&>(mFeature).Eval(s);
-    for(int i=0; i<mSvs.size(); ++i)
+    if(mDoubleBuffered)
     {
-        const SupportVector& sv = *mSvs[i];
-        if(sv.b > 0)
+        for(int i=0; i<(int)mFrontB.size(); ++i)
         {
-            ++numPsv;
-            sim += mKernel.Eval(tfv, sv.x->x[sv.y]);
+            if(mFrontB[i] > 0)
+            {
+                ++numPsv;
+                sim += mKernel.Eval(tfv, mFrontX[i]);
+            }
+        }
+    }
+    else
+    {
+        for(int i=0; i<mSvs.size(); ++i)
+        {
+            const SupportVector& sv = *mSvs[i];
+            if(sv.b > 0)
+            {
+                ++numPsv;
+                sim += mKernel.Eval(tfv, sv.x->x[sv.y]);
+            }
         }
     }
     sim /= numPsv;
@@ -187,7 +250,7 @@ std::pair<int, double> structuredSVM::MinGradient(int ind)
     std::pair<int, double> minGrad(-1, DBL_MAX);
     for(int i=0; i<(int)sp->yv.size(); ++i)
     {
-        double grad = -Loss(sp->yv[i], sp->yv[sp->y]) - Evaluate(sp->x[i]);
+        double grad = -sp->loss[i] - Evaluate(sp->x[i]);
         if (grad < minGrad.second)
         {
             minGrad.first = i;
@@ -201,6 +264,7 @@ std::pair<int, double> structuredSVM::MinGradient(int ind)
 
 void structuredSVM::ProcessNew(int ind)
 {
+    ScopedTimer timer(mTimes, kStageSvmProcessNew);
     // gradient is -f(x,y) since loss=0
     int ipos = AddSupportVector(mSps[ind], mSps[ind]->y, -Evaluate(mSps[ind]->x[mSps[ind]->y]));
 
@@ -216,18 +280,176 @@ void structuredSVM::ProcessNew(int ind)
 
 void structuredSVM::Reprocess()
 {
+    ScopedTimer timer(mTimes, kStageSvmReprocess);
+    int numThreads = std::min(mConfig.mSvmThreads, (int)mSps.size());
+    if(numThreads > 1)
+    {
+        ReprocessParallel(numThreads);
+        return;
+    }
+
     ProcessOld();
-    for(int i=0; i< 10; ++i)
+    for(int i=0; i< kOptimizeNum; ++i)
         Optimize();
 }
 
+// Parallel version of Reprocess: every sweep works on numThreads distinct
+// patterns at once. Each thread only changes the betas of its own pattern and
+// collects the gradient changes for all svs in its own delta vector, which are
+// summed in thread order after the sweep. Patterns are chosen on the calling
+// thread, so the result only depends on the seed and the thread number.
+void structuredSVM::ReprocessParallel(int numThreads)
+{
+    std::vector<int> inds(mSps.size());
+    for(int i=0; i<(int)inds.size(); ++i)
+        inds[i] = i;
+
+    int numSweeps = 1 + (kOptimizeNum + numThreads - 1) / numThreads;
+    for(int sweep=0; sweep<numSweeps; ++sweep)
+    {
+        // choose patterns to process
+        std::vector<const SupportPattern*> sps(numThreads);
+        for(int t=0; t<numThreads; ++t)
+        {
+            std::swap(inds[t], inds[t + mRng.NextInt((int)inds.size()-t)]);
+            sps[t] = mSps[inds[t]];
+        }
+
+        std::vector<int> ips(numThreads, -1);
+        std::vector<int> ins(numThreads, -1);
+        if(sweep == 0)
+        {
+            // process old: find the most violating output of each pattern
+            std::vector<std::pair<int, double> > minGrads(numThreads);
+            parallelRun(numThreads, [&](int t) { minGrads[t] = MinGradient(inds[t]); });
+
+            // adding svs changes the kernel matrix, so do it here
+            for(int t=0; t<numThreads; ++t)
+            {
+                for(int i=0; i<(int)mSvs.size(); ++i)
+                {
+                    if(mSvs[i]->x == sps[t] && mSvs[i]->y == minGrads[t].first)
+                    {
+                        ins[t] = i;
+                        break;
+                    }
+                }
+                if(ins[t] == -1)
+                    ins[t] = AddSupportVector(const_cast<SupportPattern*>(sps[t]), minGrads[t].first, minGrads[t].second);
+            }
+            for(int t=0; t<numThreads; ++t)
+            {
+                double maxGrad = -DBL_MAX;
+                for(int i=0; i<(int)mSvs.size(); ++i)
+                {
+                    const SupportVector* svi = mSvs[i];
+                    if(svi->x != sps[t]) continue;
+                    if(svi->g > maxGrad && svi->b < mC*(int)(svi->y == sps[t]->y))
+                    {
+                        ips[t] = i;
+                        maxGrad = svi->g;
+                    }
+                }
+                assert(ips[t] != -1);
+            }
+        }
+
+        std::vector<std::vector<double> > dgs(numThreads, std::vector<double>(mSvs.size(), 0.0));
+        parallelRun(numThreads, [&](int t) {
+            if(sweep == 0)
+            {
+                if(ips[t] != -1)
+                    SMOStepDelta(ips[t], ins[t], dgs[t]);
+            }
+            else
+            {
+                OptimizeDelta(sps[t], dgs[t]);
+            }
+        });
+
+        for(int t=0; t<numThreads; ++t)
+            for(int i=0; i<(int)mSvs.size(); ++i)
+                mSvs[i]->g += dgs[t][i];
+
+        RemoveZeroSupportVectors();
+        if((int)mSps.size() < numThreads)
+            return;
+        if(inds.size() != mSps.size())
+        {
+            inds.resize(mSps.size());
+            for(int i=0; i<(int)inds.size(); ++i)
+                inds[i] = i;
+        }
+    }
+}
+
+// SMOStep which adds the gradient changes to dg instead of applying them, and
+// leaves sv removal to the caller
+void structuredSVM::SMOStepDelta(int ipos, int ineg, std::vector<double>& dg)
+{
+    if (ipos == ineg) return;
+    SupportVector* svp = mSvs[ipos];
+    SupportVector* svn = mSvs[ineg];
+    assert(svp->x == svn->x);
+    SupportPattern* sp = svp->x;
+    double gpos = svp->g + dg[ipos];
+    double gneg = svn->g + dg[ineg];
+    if ((gpos - gneg) < 1e-5) return;
+
+    double kii = mK(ipos, ipos) + mK(ineg, ineg) - 2*mK(ipos, ineg);
+    double lu = (gpos - gneg)/kii;
+    double l = cv::min(lu, mC*(int)(svp->y == sp->y) - svp->b);
+
+    svp->b += l;
+    svn->b -= l;
+
+    for(int i=0; i<(int)mSvs.size(); ++i)
+        dg[i] -= l*(mK(i, ipos) - mK(i, ineg));
+}
+
+void structuredSVM::OptimizeDelta(const SupportPattern* sp, std::vector<double>& dg)
+{
+    int ip = -1;
+    int in = -1;
+    double maxGrad = -DBL_MAX;
+    double minGrad = DBL_MAX;
+    for(int i=0; i< (int)mSvs.size(); ++i)
+    {
+        if (mSvs[i]->x != sp) continue;
+        const SupportVector* svi = mSvs[i];
+        double g = svi->g + dg[i];
+        if (g > maxGrad && svi->b < mC*(int)(svi->y == sp->y))
+        {
+            ip = i;
+            maxGrad = g;
+        }
+        if (g < minGrad)
+        {
+            in = i;
+            minGrad = g;
+        }
+    }
+    if (ip == -1 || in == -1) return;
+    SMOStepDelta(ip, in, dg);
+}
+
+void structuredSVM::RemoveZeroSupportVectors()
+{
+    // walk backwards, RemoveSupportVector swaps in the last (already checked) sv
+    for(int i=(int)mSvs.size()-1; i>=0; --i)
+    {
+        if(fabs(mSvs[i]->b) < 1e-8)
+            RemoveSupportVector(i);
+    }
+}
+
 
 
 void structuredSVM::ProcessOld()
 {
     if ( mSps.size() == 0) return;
     // choose pattern to process
-    int ind = rand() % mSps.size();
+    int ind = mRng.NextInt((int)mSps.size());
 
     // find existing sv with largest grad and nonzero beta
     int ip = -1;
@@ -274,7 +496,7 @@ void structuredSVM::Optimize()
 {
     if(mSps.size() == 0) return;
     // choose pattern to optimize
-    int ind = rand() % mSps.size();
+    int ind = mRng.NextInt((int)mSps.size());
     int ip = -1;
     int in = -1;
     double maxGrad = -DBL_MAX;
@@ -317,6 +539,14 @@ int structuredSVM::AddSupportVector(SupportPattern *x, int y, double g)
     int ind = (int)mSvs.size();
     mSvs.push_back(sv);
     x->refCount++;
+    // grow the kernel matrix geometrically with the number of svs
+    if(ind >= (int)mK.rows())
+    {
+        int N = std::max(2*(int)mK.rows(), ind+1);
+        if(mConfig.mSvmBudgetSize > 0)
+            N = std::max(std::min(N, mConfig.mSvmBudgetSize+2), ind+1);
+        ResizeKernelMatrix(N);
+    }
 #if VERBOSE
     std::cout<< "Add in SV: "<<ind<<std::endl;
 #endif
@@ -332,6 +562,12 @@ int structuredSVM::AddSupportVector(SupportPattern *x, int y, double g)
         }
         mK(ind, ind) = mKernel.Eval(x->x[y]);
     }
+    else
+    {
+        // the slot may hold the entries of a removed sv, other kernels read it as zero
+        mK.row(ind).setZero();
+        mK.col(ind).setZero();
+    }
 
     return ind;
 }
@@ -341,18 +577,28 @@ void structuredSVM::RemoveSupportVector(int ind)
 #if VERBOSE
     std::cout<<"Removing SV: "<< ind << std::endl;
 #endif
-    mSvs[ind]->x->refCount--;
-    if(mSvs[ind]->x->refCount == 0)
+    SupportPattern* sp = mSvs[ind]->x;
+    int y = mSvs[ind]->y;
+    sp->refCount--;
+    if(sp->refCount == 0)
     {
         // also remove the support pattern
         for(int i=0; i<(int) mSps.size(); ++i)
-            if(mSps[i] == mSvs[ind]->x)
+            if(mSps[i] == sp)
             {
                 delete mSps[i];
                 mSps.erase(mSps.begin()+i);
                 break;
             }
     }
+    else if(y >= (int)sp->yv.size())
+    {
+        // release the vector synthesized by merging, its slot is reused by the next merge
+        sp->x[y] = Eigen::VectorXd();
+        if(!sp->images.empty())
+            sp->images[y] = cv::Mat();
+        sp->freeSlots.push_back(y);
+    }
     // make sure the support vector is at the back, this lets us keep the kernel matrix cached and valid
     if(ind<(int)mSvs.size()-1)
     {
@@ -427,21 +673,139 @@ void structuredSVM::BudgetMaintenanceRemove()
 
     // update gradients
     // TODO: this could be made cheaper by just adjusting incrementally rather than recomputing
+    int numThreads = std::max(1, std::min(mConfig.mSvmThreads, (int)mSvs.size()));
+    parallelRun(numThreads, [&](int t) {
+        for (int i = t; i < (int)mSvs.size(); i += numThreads)
+        {
+            SupportVector& svi = *mSvs[i];
+            svi.g = -svi.x->loss[svi.y] - Evaluate(svi.x->x[svi.y]);
+        }
+    });
+
+}
+
+void structuredSVM::BudgetMaintenanceMerge()
+{
+    // merging relies on the kernel being linear in the feature vector
+    if(mConfig.mFeatureKernelPair.mKernel != Config::kKernelTypeLinear)
+    {
+        BudgetMaintenanceRemove();
+        return;
+    }
+
+    // find the pair of negative svs of the same pattern which are closest in feature space
+    double minVal = DBL_MAX;
+    int i1 = -1;
+    int i2 = -1;
     for (int i = 0; i < (int)mSvs.size(); ++i)
     {
-        SupportVector& svi = *mSvs[i];
-        svi.g = -Loss(svi.x->yv[svi.y],svi.x->yv[svi.x->y]) - Evaluate(svi.x->x[svi.y]);
+        if (mSvs[i]->b >= 0.0) continue;
+        for (int j = i+1; j < (int)mSvs.size(); ++j)
+        {
+            if (mSvs[j]->b >= 0.0 || mSvs[j]->x != mSvs[i]->x) continue;
+            double bi = -mSvs[i]->b;
+            double bj = -mSvs[j]->b;
+            double val = bi*bj/(bi+bj) * (mK(i,i) + mK(j,j) - 2.0*mK(i,j));
+            if (val < minVal)
+            {
+                minVal = val;
+                i1 = i;
+                i2 = j;
+            }
+        }
+    }
+    if (i1 == -1)
+    {
+        // no pattern has two negative svs left
+        BudgetMaintenanceRemove();
+        return;
     }
 
+    // replace the pair by a single sv on their weighted mean, with beta = b1 + b2.
+    // for the linear kernel the discriminant function is unchanged, and so are the
+    // gradients of all other svs, the merged sv gets the weighted mean loss and gradient.
+    SupportVector* sv1 = mSvs[i1];
+    SupportVector* sv2 = mSvs[i2];
+    SupportPattern* sp = sv1->x;
+    double b = sv1->b + sv2->b;
+    double w1 = sv1->b / b;
+    double w2 = sv2->b / b;
+    Eigen::VectorXd z = w1*sp->x[sv1->y] + w2*sp->x[sv2->y];
+    double loss = w1*sp->loss[sv1->y] + w2*sp->loss[sv2->y];
+
+    // reuse the slot of a previously merged vector if there is one
+    int y;
+    if (sv1->y >= (int)sp->yv.size())
+        y = sv1->y;
+    else if (sv2->y >= (int)sp->yv.size())
+    {
+        // the slot moves to sv1, so removing sv2 below must not release it
+        y = sv2->y;
+        sv2->y = sv1->y;
+    }
+    else
+    {
+        int yImage = sv1->b < sv2->b ? sv1->y : sv2->y;
+        if (!sp->freeSlots.empty())
+        {
+            y = sp->freeSlots.back();
+            sp->freeSlots.pop_back();
+            if (!sp->images.empty())
+                sp->images[y] = sp->images[yImage];
+        }
+        else
+        {
+            y = (int)sp->x.size();
+            sp->x.push_back(Eigen::VectorXd());
+            sp->loss.push_back(0.0);
+            if (!sp->images.empty())
+                sp->images.push_back(sp->images[yImage]);
+        }
+    }
+    sp->x[y] = z;
+    sp->loss[y] = loss;
+
+    sv1->g = w1*sv1->g + w2*sv2->g;
+    sv1->b = b;
+    sv1->y = y;
+
+    // update kernel matrix
+    for (int i = 0; i < (int)mSvs.size(); ++i)
+    {
+        if (i == i1) continue;
+        mK(i, i1) = mKernel.Eval(mSvs[i]->x->x[mSvs[i]->y], z);
+        mK(i1, i) = mK(i, i1);
+    }
+    mK(i1, i1) = mKernel.Eval(z);
+
+    RemoveSupportVector(i2);
 }
 
 void structuredSVM::BudgetMaintenance()
 {
-    if(mConfig.mSvmBudgetSize > 0)
+    // only calls which remove svs are timed
+    if(mConfig.mSvmBudgetSize > 0 && (int)mSvs.size() > mConfig.mSvmBudgetSize)
     {
+        ScopedTimer timer(mTimes, kStageSvmBudget);
         while((int)mSvs.size() > mConfig.mSvmBudgetSize)
-            BudgetMaintenanceRemove();
+        {
+            if(mConfig.mSvmBudgetType == Config::kBudgetTypeMerge)
+                BudgetMaintenanceMerge();
+            else
+                BudgetMaintenanceRemove();
+        }
     }
+
+    // release kernel matrix memory once most of it is unused
+    int N = (int)mK.rows();
+    if(N > kMinKernelSize && 4*(int)mSvs.size() < N)
+        ResizeKernelMatrix(std::max(kMinKernelSize, 2*(int)mSvs.size()));
+}
+
+void structuredSVM::ResizeKernelMatrix(int N)
+{
+    // keeps the cached entries of the live svs in the top-left corner, the grown part is zero
+    mK.conservativeResizeLike(Eigen::MatrixXd::Zero(N, N));
 }
 
 
@@ -458,9 +822,18 @@ double structuredSVM::Evaluate(const Eigen::VectorXd &x) const
     return f;
 }
 
+double structuredSVM::EvaluateFront(const Eigen::VectorXd &x) const
+{
+    double f = 0.0;
+    for(int i=0; i<(int)mFrontB.size(); ++i)
+        f += mFrontB[i]*mKernel.Eval(x, mFrontX[i]);
+
+    return f;
+}
+
 double structuredSVM::Test(const Eigen::VectorXd &x) const
 {
-    return mW.dot(x);
+    return GetW().dot(x);
 }
 
 void structuredSVM::UpdateDebugImage()
@@ -484,9 +857,8 @@ void structuredSVM::UpdateDebugImage()
     int x = 0;
     int y = 0;
     int ind = 0;
-    float vals[kMaxSVs];
-    memset(vals, 0, sizeof(float)*n);
-    int drawOrder[kMaxSVs];
+    std::vector<float> vals(n, 0.f);
+    std::vector<int> drawOrder(n);
 
     for (int set = 0; set < 2; ++set)
     {
@@ -515,8 +887,8 @@ void structuredSVM::UpdateDebugImage()
     const int kKernelPixelSize = 2;
     int kernelSize = kKernelPixelSize*n;
 
-    double kmin = mK.minCoeff();
-    double kmax = mK.maxCoeff();
+    double kmin = mK.topLeftCorner(n, n).minCoeff();
+    double kmax = mK.topLeftCorner(n, n).maxCoeff();
 
     if (kernelSize < mDebugImage.cols && kernelSize < mDebugImage.rows)
     {
@@ -541,6 +913,6 @@ void structuredSVM::UpdateDebugImage()
     I.setTo(cv::Scalar(255,255,255));
     IplImage II = I;
     setGraphColor(0);
-    drawFloatGraph(vals, n, &II, 0.f, 0.f, I.cols, I.rows);
+    drawFloatGraph(&vals[0], n, &II, 0.f, 0.f, I.cols, I.rows);
 }
 